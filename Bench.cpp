@@ -0,0 +1,403 @@
+#include "ExactSteiner.h"
+#include "LookupTable.h"
+#include "Net.h"
+#include "Parallel.h"
+#include "Router.h"
+#include "Timer.h"
+#include "Types.h"
+#include "XmlWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cstdlib>
+#include <cstring>
+
+// Count heap allocations, so stats show how many of them rounds make.
+// All forms of new and delete are replaced, so every block is counted
+// and freed by the same pair of functions. They are not inlined, so the
+// compiler doesn't see free() called on memory from operator new.
+static std::atomic<size_t> Allocations{0};
+
+[[gnu::noinline]] static void *allocate(std::size_t Size,
+                                        std::align_val_t Align) noexcept {
+  Allocations.fetch_add(1, std::memory_order_relaxed);
+  size_t A = static_cast<size_t>(Align);
+  Size = std::max<std::size_t>(Size, 1);
+  if (A <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    return std::malloc(Size);
+  // Size should be a multiple of the alignment.
+  return std::aligned_alloc(A, (Size + A - 1) / A * A);
+}
+
+static void *allocateOrThrow(std::size_t Size, std::align_val_t Align) {
+  if (void *P = allocate(Size, Align))
+    return P;
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] static void deallocate(void *P) noexcept { std::free(P); }
+
+static constexpr std::align_val_t DefaultAlign{
+  __STDCPP_DEFAULT_NEW_ALIGNMENT__};
+
+void *operator new(std::size_t Size) {
+  return allocateOrThrow(Size, DefaultAlign);
+}
+void *operator new[](std::size_t Size) {
+  return allocateOrThrow(Size, DefaultAlign);
+}
+void *operator new(std::size_t Size, std::align_val_t Align) {
+  return allocateOrThrow(Size, Align);
+}
+void *operator new[](std::size_t Size, std::align_val_t Align) {
+  return allocateOrThrow(Size, Align);
+}
+void *operator new(std::size_t Size, const std::nothrow_t &) noexcept {
+  return allocate(Size, DefaultAlign);
+}
+void *operator new[](std::size_t Size, const std::nothrow_t &) noexcept {
+  return allocate(Size, DefaultAlign);
+}
+void *operator new(std::size_t Size, std::align_val_t Align,
+                   const std::nothrow_t &) noexcept {
+  return allocate(Size, Align);
+}
+void *operator new[](std::size_t Size, std::align_val_t Align,
+                     const std::nothrow_t &) noexcept {
+  return allocate(Size, Align);
+}
+
+void operator delete(void *P) noexcept { deallocate(P); }
+void operator delete[](void *P) noexcept { deallocate(P); }
+void operator delete(void *P, std::size_t) noexcept { deallocate(P); }
+void operator delete[](void *P, std::size_t) noexcept { deallocate(P); }
+void operator delete(void *P, std::align_val_t) noexcept { deallocate(P); }
+void operator delete[](void *P, std::align_val_t) noexcept { deallocate(P); }
+void operator delete(void *P, std::size_t, std::align_val_t) noexcept {
+  deallocate(P);
+}
+void operator delete[](void *P, std::size_t, std::align_val_t) noexcept {
+  deallocate(P);
+}
+void operator delete(void *P, const std::nothrow_t &) noexcept {
+  deallocate(P);
+}
+void operator delete[](void *P, const std::nothrow_t &) noexcept {
+  deallocate(P);
+}
+void operator delete(void *P, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  deallocate(P);
+}
+void operator delete[](void *P, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  deallocate(P);
+}
+
+// Synthetic nets for benchmarking.
+enum class Distribution {
+  // Pins are spread uniformly over the grid.
+  Uniform,
+  // Pins are grouped around a few centers.
+  Clustered,
+  // Pins lie on few tracks, so many of them share x or y.
+  GridAligned
+};
+
+static const char *getDistributionName(Distribution D) {
+  switch (D) {
+  case Distribution::Uniform:
+    return "uniform";
+  case Distribution::Clustered:
+    return "clustered";
+  case Distribution::GridAligned:
+    return "grid";
+  }
+  __builtin_unreachable();
+}
+
+static Net generateNet(Distribution D, size_t Degree, uint64_t Seed) {
+  std::mt19937_64 Rand(Seed);
+  Unit Span = std::max<Unit>(1000, 10 * Degree);
+  Net N;
+  N.addCorners(Point(0, 0), Point(Span, Span));
+  N.reserve(Degree);
+
+  std::uniform_int_distribution<Unit> Coord(0, Span);
+  std::set<Point> Used;
+  std::vector<Point> Centers;
+  std::vector<Unit> Tracks;
+  if (D == Distribution::Clustered) {
+    size_t CNum = std::max<size_t>(2, Degree / 64);
+    for (size_t i = 0; i < CNum; ++i)
+      Centers.emplace_back(Coord(Rand), Coord(Rand));
+  } else if (D == Distribution::GridAligned) {
+    // Distinct tracks, so there are enough different points.
+    size_t TNum = 2 * static_cast<size_t>(std::ceil(std::sqrt(Degree)));
+    std::set<Unit> Unique;
+    while (Unique.size() < TNum)
+      Unique.insert(Coord(Rand));
+    Tracks.assign(Unique.begin(), Unique.end());
+  }
+  std::normal_distribution<double> Spread(0, Span / 32.0);
+
+  while (N.size() < Degree) {
+    Point P;
+    switch (D) {
+    case Distribution::Uniform:
+      P = Point(Coord(Rand), Coord(Rand));
+      break;
+    case Distribution::Clustered: {
+      Point C = Centers[Rand() % Centers.size()];
+      auto Clamp = [Span](double V) {
+        return std::min<Unit>(Span, std::max<Unit>(0, std::lround(V)));
+      };
+      P = Point(Clamp(C.x + Spread(Rand)), Clamp(C.y + Spread(Rand)));
+      break;
+    }
+    case Distribution::GridAligned:
+      P = Point(Tracks[Rand() % Tracks.size()], Tracks[Rand() % Tracks.size()]);
+      break;
+    }
+    if (Used.insert(P).second)
+      N.addPoint(P);
+  }
+  return N;
+}
+
+struct BenchOptions {
+  std::vector<size_t> Degrees = {3, 10, 30, 100, 300};
+  std::vector<Distribution> Dists = {Distribution::Uniform,
+                                     Distribution::Clustered,
+                                     Distribution::GridAligned};
+  uint64_t Seed = 1;
+  size_t Threads = 1;
+  std::string Output;
+  std::string LUTFile;
+  // Nets with at most this many pins are also solved exactly to see
+  // how much longer the routed trees are.
+  size_t OracleDegree = 0;
+  SteinerOptions Steiner;
+};
+
+static uint64_t parseNumber(const char *Opt, const char *Val) {
+  char *End;
+  unsigned long long Res = std::strtoull(Val, &End, 10);
+  if (*Val == '\0' || *Val == '-' || *End != '\0')
+    report_error("Invalid value for ", Opt, ": '", Val, "'.\n");
+  return Res;
+}
+
+static size_t parseExactDegree(const char *Opt, const char *Val) {
+  size_t Degree = parseNumber(Opt, Val);
+  if (Degree > MaxExactDegree)
+    report_error("Exact solver supports at most ", MaxExactDegree, " pins.\n");
+  return Degree;
+}
+
+// Split comma separated list.
+static std::vector<std::string> splitList(const char *Val) {
+  std::vector<std::string> Res;
+  std::stringstream SS(Val);
+  std::string Item;
+  while (std::getline(SS, Item, ','))
+    Res.push_back(Item);
+  return Res;
+}
+
+static BenchOptions parseArgs(int argc, char **argv) {
+  BenchOptions Opts;
+  for (int i = 1; i < argc; ++i) {
+    auto getValue = [&]() {
+      if (i + 1 == argc)
+        report_error("Option ", argv[i], " requires a value.\n");
+      return argv[++i];
+    };
+
+    if (strcmp(argv[i], "--help") == 0) {
+      std::cout <<
+        "Usage: Bench <options>.\n"
+        "Routes seeded random nets and prints timings of stages as JSON.\n"
+        "Fails if a round after the first one allocates memory.\n"
+        "Allowed options:\n"
+        "  --help              prints usage and exits\n"
+        "  --degrees <list>    comma separated numbers of pins (3,10,30,100,300)\n"
+        "  --generators <list> comma separated subset of uniform,clustered,grid\n"
+        "  --seed <n>          seed of generators (1)\n"
+        "  --threads <n>       evaluate candidates with n threads (0 -- all cores)\n"
+        "  --batched           add several non-interfering points per round\n"
+        "  --lazy              re-evaluate only candidates with the best stale gain,\n"
+        "                      points which don't shorten the tree aren't added\n"
+        "                      (as if --min-gain is at least 1)\n"
+        "  --prune <n>         pruning level of candidates (0 -- Hanan grid, 1, 2)\n"
+        "  --lut <file>        route small nets with lookup table built by GenLUT\n"
+        "  --exact <n>         build optimal trees for nets with at most n pins\n"
+        "  --oracle <n>        compare with optimal trees for at most n pins\n"
+        "  --cluster-size <n>  split nets with more than n pins into clusters\n"
+        "  --time-budget <ms>  stop adding points to a net after ms milliseconds\n"
+        "  --max-rounds <n>    stop adding points to a net after n rounds\n"
+        "  --min-gain <n>      don't add points which shorten the tree by less\n"
+        "  --output <file>     write results to file instead of stdout"
+                << std::endl;
+      exit(0);
+    } else if (strcmp(argv[i], "--degrees") == 0) {
+      const char *Opt = argv[i];
+      Opts.Degrees.clear();
+      for (const auto &D : splitList(getValue()))
+        Opts.Degrees.push_back(parseNumber(Opt, D.c_str()));
+    } else if (strcmp(argv[i], "--generators") == 0) {
+      Opts.Dists.clear();
+      for (const auto &G : splitList(getValue())) {
+        if (G == "uniform")
+          Opts.Dists.push_back(Distribution::Uniform);
+        else if (G == "clustered")
+          Opts.Dists.push_back(Distribution::Clustered);
+        else if (G == "grid")
+          Opts.Dists.push_back(Distribution::GridAligned);
+        else
+          report_error("Unknown generator '", G, "'.\n");
+      }
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      const char *Opt = argv[i];
+      Opts.Seed = parseNumber(Opt, getValue());
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      const char *Opt = argv[i];
+      Opts.Threads = getThreadsNum(parseNumber(Opt, getValue()));
+    } else if (strcmp(argv[i], "--batched") == 0) {
+      Opts.Steiner.Batched = true;
+    } else if (strcmp(argv[i], "--lazy") == 0) {
+      Opts.Steiner.Lazy = true;
+    } else if (strcmp(argv[i], "--output") == 0) {
+      Opts.Output = getValue();
+    } else if (strcmp(argv[i], "--lut") == 0) {
+      Opts.LUTFile = getValue();
+    } else if (strcmp(argv[i], "--prune") == 0) {
+      const char *Opt = argv[i];
+      Opts.Steiner.Pruning = parseNumber(Opt, getValue());
+      if (Opts.Steiner.Pruning > MaxPruning)
+        report_error("Pruning level should be at most ", MaxPruning, ".\n");
+    } else if (strcmp(argv[i], "--exact") == 0) {
+      const char *Opt = argv[i];
+      Opts.Steiner.ExactDegree = parseExactDegree(Opt, getValue());
+    } else if (strcmp(argv[i], "--oracle") == 0) {
+      const char *Opt = argv[i];
+      Opts.OracleDegree = parseExactDegree(Opt, getValue());
+    } else if (strcmp(argv[i], "--cluster-size") == 0) {
+      const char *Opt = argv[i];
+      Opts.Steiner.ClusterSize = parseNumber(Opt, getValue());
+    } else if (strcmp(argv[i], "--time-budget") == 0) {
+      const char *Opt = argv[i];
+      Opts.Steiner.TimeBudgetMs =
+        std::min<double>(parseNumber(Opt, getValue()), MaxTimeBudgetMs);
+    } else if (strcmp(argv[i], "--max-rounds") == 0) {
+      const char *Opt = argv[i];
+      Opts.Steiner.MaxRounds = parseNumber(Opt, getValue());
+    } else if (strcmp(argv[i], "--min-gain") == 0) {
+      const char *Opt = argv[i];
+      Opts.Steiner.MinGain = parseNumber(Opt, getValue());
+    } else {
+      report_error("Unknown option '", argv[i], "'. Try --help.\n");
+    }
+  }
+  return Opts;
+}
+
+static void runBench(std::ostream &O, Distribution D, size_t Degree,
+                     uint64_t Seed, const SteinerOptions &Opts,
+                     size_t OracleDegree) {
+  Net N = generateNet(D, Degree, Seed);
+
+  SteinerStats Stats;
+  Timer T;
+  routeNet(N, Opts, &Stats);
+  double RouteMs = T.elapsedMs();
+  // The first round sizes scratch buffers, later ones reuse them.
+  for (size_t i = 1, e = Stats.RoundAllocations.size(); i < e; ++i)
+    if (Stats.RoundAllocations[i] != 0)
+      report_error("Round ", i, " of ", getDistributionName(D), " net of ",
+                   Degree, " pins made ", Stats.RoundAllocations[i],
+                   " heap allocations.\n");
+
+  T.reset();
+  std::ostringstream XML;
+  {
+    XmlWriter W(XML);
+    N.dumpXML(W);
+  }
+  double DumpMs = T.elapsedMs();
+
+  O << "    {\"generator\": \"" << getDistributionName(D) << "\", "
+    << "\"degree\": " << Degree << ", \"seed\": " << Seed << ",\n"
+    << "     \"route_ms\": " << RouteMs << ", "
+    << "\"dump_xml_ms\": " << DumpMs << ", "
+    << "\"output_bytes\": " << XML.tellp() << ",\n";
+  if (N.size() <= OracleDegree) {
+    T.reset();
+    Unit ExactLen = getEdgesWeight(exactSteiner(N, Opts.Pool));
+    O << "     \"exact_ms\": " << T.elapsedMs() << ", "
+      << "\"exact_wirelength\": " << ExactLen << ", "
+      << "\"wirelength_gap\": "
+      << double(Stats.Wirelength - ExactLen) / std::max(ExactLen, 1) << ",\n";
+  }
+  if (Stats.HananPoints != 0) {
+    // Part of Hanan grid pruned away.
+    O << "     \"candidate_reduction\": "
+      << 1 - double(Stats.Candidates) / Stats.HananPoints << ",\n";
+  }
+  Stats.dumpJSONFields(O, "     ");
+  O << "}";
+}
+
+int main(int argc, char **argv) {
+  BenchOptions Opts = parseArgs(argc, argv);
+  getAllocationsNum = []() -> size_t {
+    return Allocations.load(std::memory_order_relaxed);
+  };
+  std::unique_ptr<ThreadPool> Pool;
+  if (Opts.Threads > 1) {
+    Pool = std::make_unique<ThreadPool>(Opts.Threads);
+    Opts.Steiner.Pool = Pool.get();
+  }
+  std::unique_ptr<SteinerLUT> LUT;
+  if (!Opts.LUTFile.empty()) {
+    LUT = std::make_unique<SteinerLUT>(Opts.LUTFile);
+    Opts.Steiner.LUT = LUT.get();
+  }
+
+  std::ofstream OutFile;
+  if (!Opts.Output.empty()) {
+    OutFile.open(Opts.Output);
+    if (!OutFile)
+      report_error("Can't open file '", Opts.Output, "'.\n");
+  }
+  std::ostream &O = Opts.Output.empty() ? std::cout : OutFile;
+
+  O << "{\n  \"threads\": " << Opts.Threads << ", "
+    << "\"batched\": " << (Opts.Steiner.Batched ? "true" : "false") << ", "
+    << "\"lazy\": " << (Opts.Steiner.Lazy ? "true" : "false") << ",\n"
+    << "  \"benchmarks\": [\n";
+  bool First = true;
+  for (Distribution D : Opts.Dists) {
+    for (size_t Degree : Opts.Degrees) {
+      if (!First)
+        O << ",\n";
+      First = false;
+      runBench(O, D, Degree, Opts.Seed, Opts.Steiner, Opts.OracleDegree);
+      O.flush();
+    }
+  }
+  O << "\n  ]\n}" << std::endl;
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "BinaryNet.h"
+#include "Support.h"
+
+#include <array>
+#include <type_traits>
+
+#include <cstring>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Binary nets are used in place, which needs a little-endian host");
+static_assert(sizeof(Unit) == 4 && sizeof(Point) == 8 &&
+              sizeof(Net::Segment) == 16 &&
+              std::is_standard_layout_v<Net::Segment>,
+              "Points and segments should match arrays of int32");
+
+static constexpr char Magic[4] = {'S', 'N', 'E', 'T'};
+static constexpr size_t HeaderSize = 8 * sizeof(uint32_t);
+static constexpr size_t CountsSize = 6 * sizeof(uint32_t);
+
+BinaryNetFile::BinaryNetFile(const std::string &FName): File(FName) {
+  const char *Cur = File.begin();
+  auto need = [&](size_t Bytes) {
+    if (size_t(File.end() - Cur) < Bytes)
+      report_error(FName, ": unexpected end of file.\n");
+  };
+  auto readU32 = [&]() {
+    uint32_t V;
+    std::memcpy(&V, Cur, sizeof(V));
+    Cur += sizeof(V);
+    return V;
+  };
+  auto readUnit = [&]() { return static_cast<Unit>(readU32()); };
+
+  need(HeaderSize);
+  if (std::memcmp(Cur, Magic, sizeof(Magic)) != 0)
+    report_error(FName, ": not a binary net file.\n");
+  Cur += sizeof(Magic);
+  uint32_t Version = readU32();
+  if (Version != BinaryNetVersion)
+    report_error(FName, ": unsupported version ", Version, ", expected ",
+                 BinaryNetVersion, ".\n");
+  LBCorner.x = readUnit();
+  LBCorner.y = readUnit();
+  RUCorner.x = readUnit();
+  RUCorner.y = readUnit();
+  uint32_t NetsNum = readU32();
+  readU32();
+
+  // Every net takes at least its counts, so a bad count can't make
+  // us allocate much more than the file size.
+  need(uint64_t(NetsNum) * CountsSize);
+  Nets.resize(NetsNum);
+  for (BinaryNetView &V : Nets) {
+    need(CountsSize);
+    std::array<uint32_t, 5> Counts;
+    for (uint32_t &C : Counts)
+      C = readU32();
+    readU32();
+
+    auto getArray = [&](auto &Arr, uint32_t Num) {
+      using T = std::remove_reference_t<decltype(*Arr.Data)>;
+      need(uint64_t(Num) * sizeof(T));
+      Arr.Data = reinterpret_cast<const T *>(Cur);
+      Arr.Size = Num;
+      Cur += Num * sizeof(T);
+    };
+    getArray(V.Pins, Counts[0]);
+    getArray(V.PinVias, Counts[1]);
+    getArray(V.Vias, Counts[2]);
+    getArray(V.HorSegs, Counts[3]);
+    getArray(V.VertSegs, Counts[4]);
+  }
+  if (Cur != File.end())
+    report_error(FName, ": unexpected data after the last net.\n");
+}
+
+std::vector<Net> readBinaryNets(const std::string &FName, bool Geometry) {
+  BinaryNetFile File(FName);
+  std::vector<Net> Nets(File.nets().size());
+  for (size_t i = 0, e = Nets.size(); i < e; ++i) {
+    const BinaryNetView &V = File.nets()[i];
+    Net &N = Nets[i];
+    N.addCorners(File.getLBCorner(), File.getRUCorner());
+    N.reserve(V.Pins.size());
+    for (Point P : V.Pins)
+      N.addPoint(P);
+    if (!Geometry)
+      continue;
+    for (Point P : V.Vias)
+      N.addVia(P);
+    for (const auto &S : V.HorSegs)
+      N.addHorSegment(S.first, S.second);
+    for (const auto &S : V.VertSegs)
+      N.addVertSegment(S.first, S.second);
+  }
+  return Nets;
+}
+
+template<typename T>
+static void writeArray(std::ostream &O, const T *Data, size_t Num) {
+  O.write(reinterpret_cast<const char *>(Data), Num * sizeof(T));
+}
+
+void writeBinaryNets(std::ostream &O, const std::vector<Net> &Nets) {
+  Point LB, RU;
+  if (!Nets.empty()) {
+    LB = Nets.front().getLBCorner();
+    RU = Nets.front().getRUCorner();
+  }
+  O.write(Magic, sizeof(Magic));
+  std::array<uint32_t, 7> Header = {
+    BinaryNetVersion,
+    static_cast<uint32_t>(LB.x), static_cast<uint32_t>(LB.y),
+    static_cast<uint32_t>(RU.x), static_cast<uint32_t>(RU.y),
+    static_cast<uint32_t>(Nets.size()), 0
+  };
+  writeArray(O, Header.data(), Header.size());
+
+  for (const Net &N : Nets) {
+    const Point *Pins = N.size() ? &*N.begin() : nullptr;
+    // Pins are lifted to m2 layer as vias, as in XML output.
+    std::array<uint32_t, 6> Counts = {
+      static_cast<uint32_t>(N.size()), static_cast<uint32_t>(N.size()),
+      static_cast<uint32_t>(N.vias().size()),
+      static_cast<uint32_t>(N.horSegments().size()),
+      static_cast<uint32_t>(N.vertSegments().size()), 0
+    };
+    writeArray(O, Counts.data(), Counts.size());
+    writeArray(O, Pins, N.size());
+    writeArray(O, Pins, N.size());
+    writeArray(O, N.vias().data(), N.vias().size());
+    writeArray(O, N.horSegments().data(), N.horSegments().size());
+    writeArray(O, N.vertSegments().data(), N.vertSegments().size());
+  }
+}
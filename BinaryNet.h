@@ -0,0 +1,64 @@
+#ifndef STEINER_BINARY_NET_H_DEFINED__
+#define STEINER_BINARY_NET_H_DEFINED__
+
+#include "MappedFile.h"
+#include "Net.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Binary net files (<name>.snet). All numbers are 32-bit little-endian:
+//
+//   header:   "SNET", version, min_x, min_y, max_x, max_y, number of nets, 0
+//   each net: numbers of pins, pins_m2 vias, m2_m3 vias, m2 segments and
+//             m3 segments, 0, followed by these arrays in the same order.
+//             Points are (x, y) pairs, segments are (x1, y1, x2, y2).
+//
+// Everything is aligned to 4 bytes, so arrays of a mapped file are used
+// in place without parsing or copying.
+constexpr uint32_t BinaryNetVersion = 1;
+
+// Array inside of a mapped file.
+template<typename T>
+struct BinaryArray {
+  const T *Data = nullptr;
+  size_t Size = 0;
+
+  const T *begin() const { return Data; }
+  const T *end() const { return Data + Size; }
+  size_t size() const { return Size; }
+};
+
+struct BinaryNetView {
+  BinaryArray<Point> Pins;
+  BinaryArray<Point> PinVias;
+  BinaryArray<Point> Vias;
+  BinaryArray<Net::Segment> HorSegs;
+  BinaryArray<Net::Segment> VertSegs;
+};
+
+// Mapped binary net file. Views are valid while it is alive.
+class BinaryNetFile {
+  MappedFile File;
+  Point LBCorner, RUCorner;
+  std::vector<BinaryNetView> Nets;
+
+public:
+  // Reports an error and exits if the file is not a valid net file.
+  explicit BinaryNetFile(const std::string &FName);
+
+  Point getLBCorner() const { return LBCorner; }
+  Point getRUCorner() const { return RUCorner; }
+  const std::vector<BinaryNetView> &nets() const { return Nets; }
+};
+
+// Nets of the file. Routed geometry is read only if Geometry is set.
+// pins_m2 vias are never kept since they are always the same as pins.
+std::vector<Net> readBinaryNets(const std::string &FName, bool Geometry);
+
+// Nets of one file share the grid of the first one, as in XML output.
+void writeBinaryNets(std::ostream &O, const std::vector<Net> &Nets);
+
+#endif
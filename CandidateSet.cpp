@@ -0,0 +1,25 @@
+#include "CandidateSet.h"
+
+CandidateSet::CandidateSet(RankSpace Tr):
+  Tracks(std::move(Tr)),
+  K(Tracks.isNarrow() ? Kind::NarrowList : Kind::WideList) {}
+
+CandidateSet CandidateSet::getHananGrid(const Net &N) {
+  CandidateSet Res;
+  Res.Tracks = RankSpace(N);
+  Res.K = Kind::Grid;
+  Res.YNum = Res.Tracks.getYs().size();
+  Res.Removed.assign(Res.Tracks.getXs().size() * Res.YNum, false);
+  Res.Alive = Res.Removed.size();
+  // Pins are not candidates.
+  for (auto Pt : N)
+    Res.remove(Res.Tracks.getXRank(Pt.x) * Res.YNum + Res.Tracks.getYRank(Pt.y));
+  return Res;
+}
+
+std::vector<Point> CandidateSet::points() const {
+  std::vector<Point> Res;
+  Res.reserve(Alive);
+  forEach(0, size(), [&](size_t, Point Pt) { Res.push_back(Pt); });
+  return Res;
+}
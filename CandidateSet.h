@@ -0,0 +1,108 @@
+#ifndef STEINER_CANDIDATE_SET_H_DEFINED__
+#define STEINER_CANDIDATE_SET_H_DEFINED__
+
+#include "Net.h"
+#include "RankSpace.h"
+#include "Types.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Candidate Steiner points. The Hanan grid is kept as the tracks of the
+// net only, so it takes O(n) memory plus a bit per point; pruned sets
+// are kept as lists of rank pairs, 16 bit ones if tracks allow. Removed
+// candidates are marked in a bitmap, indices of the others never change.
+class CandidateSet {
+  enum class Kind { Grid, NarrowList, WideList };
+
+  RankSpace Tracks;
+  Kind K = Kind::NarrowList;
+  // Grid point Idx has ranks (Idx / YNum, Idx % YNum).
+  size_t YNum = 0;
+  std::vector<RankPoint<uint16_t>> Narrow;
+  std::vector<RankPoint<uint32_t>> Wide;
+  std::vector<bool> Removed;
+  size_t Alive = 0;
+
+  template<typename T, typename Fn>
+  void forEachListed(const std::vector<RankPoint<T>> &Ranks, size_t Begin,
+                     size_t End, Fn F) const {
+    for (size_t i = Begin; i < End; ++i) {
+      if (!Removed[i])
+        F(i, Tracks.getPoint(Ranks[i]));
+    }
+  }
+
+public:
+  CandidateSet() = default;
+  // Empty list of points on the tracks of Tr, see add().
+  explicit CandidateSet(RankSpace Tr);
+  // The Hanan grid of the net without pins.
+  static CandidateSet getHananGrid(const Net &N);
+
+  const RankSpace &getTracks() const { return Tracks; }
+
+  // Append point with ranks X and Y to the list.
+  void add(size_t X, size_t Y) {
+    assert(K != Kind::Grid && "Grid can't be extended");
+    if (K == Kind::NarrowList)
+      Narrow.push_back({static_cast<uint16_t>(X), static_cast<uint16_t>(Y)});
+    else
+      Wide.push_back({static_cast<uint32_t>(X), static_cast<uint32_t>(Y)});
+    Removed.push_back(false);
+    ++Alive;
+  }
+
+  // Indices are below size(), removed ones included.
+  size_t size() const { return Removed.size(); }
+  // Number of candidates left.
+  size_t alive() const { return Alive; }
+  bool empty() const { return Alive == 0; }
+
+  bool isRemoved(size_t Idx) const { return Removed[Idx]; }
+  void remove(size_t Idx) {
+    if (!Removed[Idx]) {
+      Removed[Idx] = true;
+      --Alive;
+    }
+  }
+
+  Point operator[](size_t Idx) const {
+    switch (K) {
+    case Kind::Grid:
+      return Point(Tracks.getXs()[Idx / YNum], Tracks.getYs()[Idx % YNum]);
+    case Kind::NarrowList:
+      return Tracks.getPoint(Narrow[Idx]);
+    case Kind::WideList:
+      return Tracks.getPoint(Wide[Idx]);
+    }
+    __builtin_unreachable();
+  }
+
+  // Call F(Idx, Pt) for each candidate left in [Begin, End).
+  template<typename Fn>
+  void forEach(size_t Begin, size_t End, Fn F) const {
+    if (K == Kind::NarrowList)
+      return forEachListed(Narrow, Begin, End, F);
+    if (K == Kind::WideList)
+      return forEachListed(Wide, Begin, End, F);
+    if (Begin >= End)
+      return;
+    const std::vector<Unit> &Xs = Tracks.getXs(), &Ys = Tracks.getYs();
+    size_t X = Begin / YNum, Y = Begin % YNum;
+    for (size_t i = Begin; i < End; ++i) {
+      if (!Removed[i])
+        F(i, Point(Xs[X], Ys[Y]));
+      if (++Y == YNum) {
+        Y = 0;
+        ++X;
+      }
+    }
+  }
+
+  // Candidates left as a list.
+  std::vector<Point> points() const;
+};
+
+#endif
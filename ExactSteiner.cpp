@@ -0,0 +1,224 @@
+#include "ExactSteiner.h"
+#include "RankSpace.h"
+#include "Support.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace {
+// Edges of the tree on Hanan grid are kept as direction bits of nodes.
+enum Direction : uint8_t {
+  Right = 1,
+  Left = 2,
+  Up = 4,
+  Down = 8
+};
+
+// Dynamic programming tables. Cost[S * Nodes + V] is the length of the
+// shortest tree connecting terminals of subset S and node V. Choice of
+// the same index tells how it is built:
+//   0      -- V is the only terminal of S,
+//   A > 0  -- trees of subsets A and S \ A joined at V,
+//   -U - 1 -- tree of S at neighbour node U extended with edge U-V.
+class DreyfusWagner {
+  const std::vector<Unit> &Xs, &Ys;
+  size_t Cols, Rows, Nodes;
+  std::vector<Unit> Cost;
+  std::vector<int32_t> Choice;
+
+  Unit *getCost(uint32_t S) { return &Cost[size_t(S) * Nodes]; }
+  int32_t *getChoice(uint32_t S) { return &Choice[size_t(S) * Nodes]; }
+
+  void relax(Unit *C, int32_t *Ch, size_t V, size_t U, Unit W) {
+    if (C[U] + W < C[V]) {
+      C[V] = C[U] + W;
+      Ch[V] = -int32_t(U) - 1;
+    }
+  }
+
+  // Extend trees of S along grid edges. Distance on Hanan grid is
+  // rectilinear, so passes along rows and then along columns suffice.
+  void propagate(uint32_t S) {
+    Unit *C = getCost(S);
+    int32_t *Ch = getChoice(S);
+    for (size_t Row = 0; Row < Rows; ++Row) {
+      size_t B = Row * Cols;
+      for (size_t Col = 1; Col < Cols; ++Col)
+        relax(C, Ch, B + Col, B + Col - 1, Xs[Col] - Xs[Col - 1]);
+      for (size_t Col = Cols - 1; Col-- > 0;)
+        relax(C, Ch, B + Col, B + Col + 1, Xs[Col + 1] - Xs[Col]);
+    }
+    for (size_t Col = 0; Col < Cols; ++Col) {
+      for (size_t Row = 1; Row < Rows; ++Row)
+        relax(C, Ch, Row * Cols + Col, (Row - 1) * Cols + Col,
+              Ys[Row] - Ys[Row - 1]);
+      for (size_t Row = Rows - 1; Row-- > 0;)
+        relax(C, Ch, Row * Cols + Col, (Row + 1) * Cols + Col,
+              Ys[Row + 1] - Ys[Row]);
+    }
+  }
+
+public:
+  DreyfusWagner(const std::vector<Unit> &InXs, const std::vector<Unit> &InYs,
+                size_t Subsets):
+    Xs(InXs), Ys(InYs), Cols(Xs.size()), Rows(Ys.size()),
+    Nodes(Cols * Rows), Cost(Subsets * Nodes), Choice(Subsets * Nodes) {}
+
+  void initLeaf(uint32_t S, size_t Node) {
+    std::fill_n(getCost(S), Nodes, std::numeric_limits<Unit>::max() / 2);
+    getCost(S)[Node] = 0;
+    getChoice(S)[Node] = 0;
+    propagate(S);
+  }
+
+  void join(uint32_t S) {
+    Unit *C = getCost(S);
+    int32_t *Ch = getChoice(S);
+    std::fill_n(C, Nodes, std::numeric_limits<Unit>::max() / 2);
+    // Subsets with the lowest terminal of S, so each split is seen once.
+    uint32_t Low = S & -S;
+    for (uint32_t A = (S - 1) & S; A != 0; A = (A - 1) & S) {
+      if (!(A & Low))
+        continue;
+      const Unit *CA = getCost(A), *CB = getCost(S ^ A);
+      for (size_t V = 0; V < Nodes; ++V) {
+        Unit Len = CA[V] + CB[V];
+        if (Len < C[V]) {
+          C[V] = Len;
+          Ch[V] = A;
+        }
+      }
+    }
+    propagate(S);
+  }
+
+  Unit getLen(uint32_t S, size_t Node) const {
+    return Cost[size_t(S) * Nodes + Node];
+  }
+
+  // Mark edges of the tree of S at Node.
+  void getTree(uint32_t S, size_t Node, std::vector<uint8_t> &Dirs) const {
+    std::vector<std::pair<uint32_t, size_t>> Stack = {{S, Node}};
+    while (!Stack.empty()) {
+      auto [Set, V] = Stack.back();
+      Stack.pop_back();
+      int32_t Ch = Choice[size_t(Set) * Nodes + V];
+      if (Ch > 0) {
+        Stack.emplace_back(Ch, V);
+        Stack.emplace_back(Set ^ Ch, V);
+      } else if (Ch < 0) {
+        size_t U = -(Ch + 1);
+        if (U == V + 1) {
+          Dirs[V] |= Right;
+          Dirs[U] |= Left;
+        } else if (U + 1 == V) {
+          Dirs[V] |= Left;
+          Dirs[U] |= Right;
+        } else if (U > V) {
+          Dirs[V] |= Up;
+          Dirs[U] |= Down;
+        } else {
+          Dirs[V] |= Down;
+          Dirs[U] |= Up;
+        }
+        Stack.emplace_back(Set, U);
+      }
+    }
+  }
+};
+} // end anonymous namespace
+
+Graph<Point> exactSteiner(const Net &N, ThreadPool *Pool) {
+  RankSpace Tracks(N);
+  const std::vector<Unit> &Xs = Tracks.getXs(), &Ys = Tracks.getYs();
+  size_t Cols = Xs.size();
+  auto getNode = [&](Point P) {
+    return Tracks.getYRank(P.y) * Cols + Tracks.getXRank(P.x);
+  };
+
+  // Terminals are distinct nodes of pins. Vertex of each node in the
+  // result, pins come first.
+  std::vector<size_t> NodeVertex(Cols * Ys.size(), Graph<Point>::NoVertex);
+  std::vector<size_t> Terminals;
+  std::vector<Graph<Point>::EdgeType> Edges;
+  size_t PinIdx = 0;
+  for (Point P : N) {
+    size_t Node = getNode(P);
+    if (NodeVertex[Node] == Graph<Point>::NoVertex) {
+      NodeVertex[Node] = PinIdx;
+      Terminals.push_back(Node);
+    } else {
+      // Duplicate pins are connected with zero-length edges.
+      Edges.emplace_back(NodeVertex[Node], PinIdx, 0);
+    }
+    ++PinIdx;
+  }
+  Graph<Point> G(N.begin(), N.end());
+  if (Terminals.size() > MaxExactDegree)
+    report_error("Net with ", Terminals.size(), " distinct pins is too large"
+                 " for exact solver, at most ", MaxExactDegree, " allowed.\n");
+
+  if (Terminals.size() >= 2) {
+    // The last terminal is the root, subsets are of the others.
+    size_t K = Terminals.size() - 1;
+    uint32_t Full = (uint32_t(1) << K) - 1;
+    DreyfusWagner DP(Xs, Ys, size_t(Full) + 1);
+    for (size_t i = 0; i < K; ++i)
+      DP.initLeaf(uint32_t(1) << i, Terminals[i]);
+
+    // Subsets of one size depend only on smaller ones.
+    std::vector<std::vector<uint32_t>> Layers(K + 1);
+    for (uint32_t S = 1; S <= Full; ++S)
+      Layers[__builtin_popcount(S)].push_back(S);
+    for (size_t Size = 2; Size <= K; ++Size) {
+      const std::vector<uint32_t> &Layer = Layers[Size];
+      parallelFor(Pool, Layer.size(), [&](size_t, size_t Begin, size_t End) {
+          for (size_t i = Begin; i < End; ++i)
+            DP.join(Layer[i]);
+        });
+    }
+
+    std::vector<uint8_t> Dirs(NodeVertex.size(), 0);
+    DP.getTree(Full, Terminals.back(), Dirs);
+
+    // Keep pins and branching nodes, paths between them become edges.
+    for (size_t Node = 0, e = Dirs.size(); Node < e; ++Node) {
+      if (NodeVertex[Node] == Graph<Point>::NoVertex &&
+          __builtin_popcount(Dirs[Node]) > 2) {
+        NodeVertex[Node] = G.vertices_size();
+        G.push_vertice(Point(Xs[Node % Cols], Ys[Node / Cols]));
+      }
+    }
+    const std::array<uint8_t, 4> Moves = {Right, Left, Up, Down};
+    for (size_t Node = 0, e = Dirs.size(); Node < e; ++Node) {
+      size_t From = NodeVertex[Node];
+      if (From == Graph<Point>::NoVertex)
+        continue;
+      for (uint8_t Dir : Moves) {
+        if (!(Dirs[Node] & Dir))
+          continue;
+        // Follow the path through nodes of degree two.
+        size_t Cur = Node;
+        uint8_t Move = Dir;
+        while (true) {
+          Cur = Move == Right ? Cur + 1 : Move == Left ? Cur - 1 :
+                Move == Up ? Cur + Cols : Cur - Cols;
+          if (NodeVertex[Cur] != Graph<Point>::NoVertex)
+            break;
+          uint8_t Came = Move == Right ? Left : Move == Left ? Right :
+                         Move == Up ? Down : Up;
+          Move = Dirs[Cur] & ~Came;
+        }
+        // Each path is met from both ends.
+        size_t To = NodeVertex[Cur];
+        if (From < To)
+          Edges.emplace_back(From, To, dist(G.vertice(From), G.vertice(To)));
+      }
+    }
+  }
+  G.swapEdges(Edges);
+  return G;
+}
@@ -0,0 +1,20 @@
+#ifndef STEINER_EXACT_STEINER_H_DEFINED__
+#define STEINER_EXACT_STEINER_H_DEFINED__
+
+#include "MST.h"
+#include "Net.h"
+#include "Parallel.h"
+
+// Largest number of distinct pins exactSteiner accepts. Time grows as
+// 3^n and memory as 2^n times the size of Hanan grid.
+constexpr size_t MaxExactDegree = 16;
+
+// Rectilinear Steiner minimal tree by Dreyfus-Wagner dynamic programming
+// over subsets of pins on Hanan grid, which is known to contain an
+// optimal tree (M. Hanan, "On Steiner's problem with rectilinear
+// distance"). Subsets of the same size are processed in parallel with
+// Pool if it is not null. Returns a tree with pins as first N.size()
+// vertices followed by Steiner points, like iteratedSteiner.
+Graph<Point> exactSteiner(const Net &N, ThreadPool *Pool);
+
+#endif
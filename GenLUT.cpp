@@ -0,0 +1,256 @@
+// Builds the table of trees for low-degree nets used by Steiner --lut,
+// see LookupTable.h for the format.
+//
+// For every permutation of pins the net is routed with iteratedSteiner
+// (or exactSteiner with --exact) on several gap vectors: unit gaps and
+// random ones. Distinct topologies are kept unless another one is never
+// longer, that is all its gap coefficients are not greater.
+
+#include "ExactSteiner.h"
+#include "LookupTable.h"
+#include "Net.h"
+#include "Parallel.h"
+#include "Router.h"
+#include "Timer.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <cstdlib>
+#include <cstring>
+
+struct GenOptions {
+  size_t MaxDegree = 7;
+  size_t Samples = 32;
+  size_t Threads = 1;
+  // Route samples with exactSteiner instead of iteratedSteiner.
+  bool Exact = false;
+  std::string Output = "Steiner.lut";
+};
+
+static size_t parseNumber(const char *Opt, const char *Val) {
+  char *End;
+  unsigned long long Res = std::strtoull(Val, &End, 10);
+  if (*Val == '\0' || *Val == '-' || *End != '\0')
+    report_error("Invalid value for ", Opt, ": '", Val, "'.\n");
+  return Res;
+}
+
+static GenOptions parseArgs(int argc, char **argv) {
+  GenOptions Opts;
+  for (int i = 1; i < argc; ++i) {
+    auto getValue = [&]() {
+      if (i + 1 == argc)
+        report_error("Option ", argv[i], " requires a value.\n");
+      return argv[++i];
+    };
+
+    if (strcmp(argv[i], "--help") == 0) {
+      std::cout <<
+        "Usage: GenLUT <options>.\n"
+        "Builds lookup table of trees for nets of low degree.\n"
+        "Allowed options:\n"
+        "  --help              prints usage and exits\n"
+        "  --max-degree <n>    largest degree in the table, 2..9 (7)\n"
+        "  --samples <n>       gap vectors routed for each permutation (32)\n"
+        "  --threads <n>       route with n threads (0 -- all cores)\n"
+        "  --exact             route samples with optimal trees\n"
+        "  --output <file>     table file (Steiner.lut)"
+                << std::endl;
+      exit(0);
+    } else if (strcmp(argv[i], "--max-degree") == 0) {
+      const char *Opt = argv[i];
+      Opts.MaxDegree = parseNumber(Opt, getValue());
+      if (Opts.MaxDegree < 2 || Opts.MaxDegree > MaxLUTDegree)
+        report_error("Degree should be in 2..", MaxLUTDegree, ".\n");
+    } else if (strcmp(argv[i], "--samples") == 0) {
+      const char *Opt = argv[i];
+      Opts.Samples = std::max<size_t>(parseNumber(Opt, getValue()), 1);
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      const char *Opt = argv[i];
+      Opts.Threads = getThreadsNum(parseNumber(Opt, getValue()));
+    } else if (strcmp(argv[i], "--exact") == 0) {
+      Opts.Exact = true;
+    } else if (strcmp(argv[i], "--output") == 0) {
+      Opts.Output = getValue();
+    } else {
+      report_error("Unknown option '", argv[i], "'. Try --help.\n");
+    }
+  }
+  return Opts;
+}
+
+// Tree over the rank grid encoded as in the table.
+struct Topology {
+  std::vector<uint8_t> Coeffs;
+  std::vector<uint8_t> Steiner;
+  std::vector<uint8_t> Edges;
+
+  // Never longer than O.
+  bool dominates(const Topology &O) const {
+    for (size_t i = 0, e = Coeffs.size(); i < e; ++i) {
+      if (Coeffs[i] > O.Coeffs[i])
+        return false;
+    }
+    return true;
+  }
+};
+
+// Pins of G are in x rank order, all coordinates of the net are distinct.
+static Topology getTopology(const Graph<Point> &G, size_t D,
+                            const std::vector<Unit> &Xs,
+                            const std::vector<Unit> &Ys) {
+  auto getXRank = [&](size_t V) {
+    return std::lower_bound(Xs.begin(), Xs.end(), G.vertice(V).x) - Xs.begin();
+  };
+  auto getYRank = [&](size_t V) {
+    return std::lower_bound(Ys.begin(), Ys.end(), G.vertice(V).y) - Ys.begin();
+  };
+
+  Topology T;
+  T.Coeffs.assign(2 * (D - 1), 0);
+  for (size_t V = D, e = G.vertices_size(); V < e; ++V) {
+    T.Steiner.push_back(getXRank(V));
+    T.Steiner.push_back(getYRank(V));
+  }
+  for (auto Edge : G.edges()) {
+    T.Edges.push_back(Edge.From);
+    T.Edges.push_back(Edge.To);
+    size_t XFrom = getXRank(Edge.From), XTo = getXRank(Edge.To);
+    size_t YFrom = getYRank(Edge.From), YTo = getYRank(Edge.To);
+    for (size_t i = std::min(XFrom, XTo), e = std::max(XFrom, XTo); i < e; ++i)
+      ++T.Coeffs[i];
+    for (size_t i = std::min(YFrom, YTo), e = std::max(YFrom, YTo); i < e; ++i)
+      ++T.Coeffs[D - 1 + i];
+  }
+  return T;
+}
+
+// Topologies of the permutation encoded as a table entry.
+static std::vector<uint8_t> buildEntry(const std::vector<uint8_t> &Perm,
+                                       size_t PermIdx, const GenOptions &Opts) {
+  size_t D = Perm.size();
+  std::mt19937_64 Rand(D * 1000003 + PermIdx);
+  std::uniform_int_distribution<Unit> GapDist(1, 64);
+  std::vector<Topology> Found;
+  std::vector<Unit> Xs(D), Ys(D);
+  for (size_t Sample = 0; Sample < Opts.Samples; ++Sample) {
+    // The first sample has unit gaps.
+    Unit X = 0, Y = 0;
+    for (size_t i = 0; i < D; ++i) {
+      Xs[i] = X;
+      Ys[i] = Y;
+      X += Sample ? GapDist(Rand) : 1;
+      Y += Sample ? GapDist(Rand) : 1;
+    }
+
+    Net N;
+    N.addCorners(Point(0, 0), Point(Xs.back(), Ys.back()));
+    for (size_t i = 0; i < D; ++i)
+      N.addPoint(Point(Xs[i], Ys[Perm[i]]));
+    Graph<Point> G = Opts.Exact ? exactSteiner(N, nullptr) :
+      iteratedSteiner(N, CandidateSet::getHananGrid(N), SteinerOptions());
+    Topology T = getTopology(G, D, Xs, Ys);
+    bool Known = std::any_of(Found.begin(), Found.end(), [&](const Topology &O) {
+        return O.Coeffs == T.Coeffs;
+      });
+    if (!Known)
+      Found.push_back(std::move(T));
+  }
+
+  // Drop topologies which are never better than another one.
+  std::vector<uint8_t> Entry(1, 0);
+  for (size_t i = 0, e = Found.size(); i < e; ++i) {
+    bool Dominated = false;
+    for (size_t j = 0; j < e && !Dominated; ++j)
+      Dominated = j != i && Found[j].dominates(Found[i]);
+    if (Dominated || Entry[0] == 255)
+      continue;
+    const Topology &T = Found[i];
+    ++Entry[0];
+    Entry.insert(Entry.end(), T.Coeffs.begin(), T.Coeffs.end());
+    Entry.push_back(T.Steiner.size() / 2);
+    Entry.insert(Entry.end(), T.Steiner.begin(), T.Steiner.end());
+    Entry.insert(Entry.end(), T.Edges.begin(), T.Edges.end());
+  }
+  return Entry;
+}
+
+// Permutation of 0..D-1 with index Idx in lexicographic order.
+static std::vector<uint8_t> getPermutation(size_t D, size_t Idx) {
+  std::vector<uint8_t> Left(D);
+  std::iota(Left.begin(), Left.end(), 0);
+  std::vector<size_t> Factorials(D, 1);
+  for (size_t i = 1; i < D; ++i)
+    Factorials[i] = Factorials[i - 1] * i;
+  std::vector<uint8_t> Perm;
+  for (size_t i = D; i-- > 0;) {
+    size_t Pos = Idx / Factorials[i];
+    Idx %= Factorials[i];
+    Perm.push_back(Left[Pos]);
+    Left.erase(Left.begin() + Pos);
+  }
+  return Perm;
+}
+
+template<typename T>
+static void writeArray(std::ostream &O, const T *Data, size_t Num) {
+  O.write(reinterpret_cast<const char *>(Data), Num * sizeof(T));
+}
+
+int main(int argc, char **argv) {
+  GenOptions Opts = parseArgs(argc, argv);
+  std::unique_ptr<ThreadPool> Pool;
+  if (Opts.Threads > 1)
+    Pool = std::make_unique<ThreadPool>(Opts.Threads);
+
+  std::ofstream Out(Opts.Output, std::ios::binary);
+  if (!Out)
+    report_error("Can't open file '", Opts.Output, "'.\n");
+  Out.write("SLUT", 4);
+  uint32_t Header[] = {LUTVersion, static_cast<uint32_t>(Opts.MaxDegree), 0};
+  writeArray(Out, Header, 3);
+
+  for (size_t D = 2; D <= Opts.MaxDegree; ++D) {
+    Timer T;
+    size_t Entries = 1;
+    for (size_t i = 2; i <= D; ++i)
+      Entries *= i;
+
+    std::vector<std::vector<uint8_t>> Encoded(Entries);
+    parallelFor(Pool.get(), Entries, [&](size_t, size_t Begin, size_t End) {
+        std::vector<uint8_t> Perm = getPermutation(D, Begin);
+        for (size_t i = Begin; i < End; ++i) {
+          Encoded[i] = buildEntry(Perm, i, Opts);
+          std::next_permutation(Perm.begin(), Perm.end());
+        }
+      });
+
+    std::vector<uint32_t> Offsets(Entries + 1, 0);
+    size_t Topologies = 0;
+    for (size_t i = 0; i < Entries; ++i) {
+      Offsets[i + 1] = Offsets[i] + Encoded[i].size();
+      Topologies += Encoded[i][0];
+    }
+    writeArray(Out, Offsets.data(), Offsets.size());
+    for (const auto &E : Encoded)
+      writeArray(Out, E.data(), E.size());
+    // Keep offsets of the next degree aligned.
+    const char Padding[4] = {};
+    writeArray(Out, Padding, (4 - Offsets.back() % 4) % 4);
+
+    std::cout << "degree " << D << ": " << Entries << " permutations, "
+              << Topologies << " topologies, " << T.elapsedMs() << " ms"
+              << std::endl;
+  }
+  if (!Out)
+    report_error("Can't write file '", Opts.Output, "'.\n");
+  return 0;
+}
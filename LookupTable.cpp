@@ -0,0 +1,168 @@
+#include "LookupTable.h"
+#include "Support.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+#include <cstring>
+
+static constexpr char Magic[4] = {'S', 'L', 'U', 'T'};
+
+static size_t getFactorial(size_t Num) {
+  size_t Res = 1;
+  for (size_t i = 2; i <= Num; ++i)
+    Res *= i;
+  return Res;
+}
+
+size_t getPermutationIndex(const uint8_t *Perm, size_t Num) {
+  size_t Res = 0;
+  for (size_t i = 0; i < Num; ++i) {
+    // Lehmer code: number of smaller elements to the right.
+    size_t Smaller = 0;
+    for (size_t j = i + 1; j < Num; ++j)
+      Smaller += Perm[j] < Perm[i];
+    Res = Res * (Num - i) + Smaller;
+  }
+  return Res;
+}
+
+// Checks that the entry fills [Begin, End) exactly and its ranks and
+// nodes are in range, so route() can trust the table.
+static bool checkEntry(const uint8_t *Begin, const uint8_t *End, size_t D) {
+  const uint8_t *Cur = Begin;
+  if (Cur == End)
+    return false;
+  size_t TopologiesNum = *Cur++;
+  if (TopologiesNum == 0)
+    return false;
+  for (size_t T = 0; T < TopologiesNum; ++T) {
+    if (size_t(End - Cur) < 2 * (D - 1) + 1)
+      return false;
+    Cur += 2 * (D - 1);
+    size_t S = *Cur++;
+    if (size_t(End - Cur) < 2 * S + 2 * (D + S - 1))
+      return false;
+    for (size_t i = 0; i < 2 * S; ++i)
+      if (*Cur++ >= D)
+        return false;
+    for (size_t i = 0; i < 2 * (D + S - 1); ++i)
+      if (*Cur++ >= D + S)
+        return false;
+  }
+  return Cur == End;
+}
+
+SteinerLUT::SteinerLUT(const std::string &FName): File(FName) {
+  const char *Cur = File.begin();
+  auto need = [&](size_t Bytes) {
+    if (size_t(File.end() - Cur) < Bytes)
+      report_error(FName, ": unexpected end of file.\n");
+  };
+  auto readU32 = [&]() {
+    uint32_t V;
+    std::memcpy(&V, Cur, sizeof(V));
+    Cur += sizeof(V);
+    return V;
+  };
+
+  need(4 * sizeof(uint32_t));
+  if (std::memcmp(Cur, Magic, sizeof(Magic)) != 0)
+    report_error(FName, ": not a lookup table.\n");
+  Cur += sizeof(Magic);
+  uint32_t Version = readU32();
+  if (Version != LUTVersion)
+    report_error(FName, ": unsupported version ", Version, ", expected ",
+                 LUTVersion, ".\n");
+  MaxDegree = readU32();
+  readU32();
+  if (MaxDegree < 2 || MaxDegree > MaxLUTDegree)
+    report_error(FName, ": unsupported degree ", MaxDegree, ".\n");
+
+  Offsets.resize(MaxDegree + 1, nullptr);
+  Data.resize(MaxDegree + 1, nullptr);
+  for (size_t D = 2; D <= MaxDegree; ++D) {
+    size_t Entries = getFactorial(D);
+    need((Entries + 1) * sizeof(uint32_t));
+    Offsets[D] = reinterpret_cast<const uint32_t *>(Cur);
+    Cur += (Entries + 1) * sizeof(uint32_t);
+    size_t Size = Offsets[D][Entries];
+    need((Size + 3) / 4 * 4);
+    Data[D] = reinterpret_cast<const uint8_t *>(Cur);
+    Cur += (Size + 3) / 4 * 4;
+    for (size_t Idx = 0; Idx < Entries; ++Idx)
+      if (Offsets[D][Idx] > Offsets[D][Idx + 1] ||
+          !checkEntry(Data[D] + Offsets[D][Idx], Data[D] + Offsets[D][Idx + 1],
+                      D))
+        report_error(FName, ": bad entry ", Idx, " of degree ", D, ".\n");
+  }
+  if (Cur != File.end())
+    report_error(FName, ": unexpected data after the last table.\n");
+}
+
+Graph<Point> SteinerLUT::route(const Net &N) const {
+  size_t D = N.size();
+  if (D > MaxDegree)
+    report_error("Net of ", D, " pins is too large for the lookup table.\n");
+  Graph<Point> G(N.begin(), N.end());
+  if (D < 2)
+    return G;
+
+  // Ties are broken by the other coordinate and then by index, so
+  // equal coordinates just give zero gaps.
+  std::array<uint8_t, MaxLUTDegree> XOrder, YOrder, YRank, Perm;
+  for (size_t i = 0; i < D; ++i)
+    XOrder[i] = YOrder[i] = i;
+  const Point *Pts = &*N.begin();
+  std::sort(XOrder.begin(), XOrder.begin() + D, [&](uint8_t A, uint8_t B) {
+      return std::tie(Pts[A].x, Pts[A].y, A) < std::tie(Pts[B].x, Pts[B].y, B);
+    });
+  std::sort(YOrder.begin(), YOrder.begin() + D, [&](uint8_t A, uint8_t B) {
+      return std::tie(Pts[A].y, Pts[A].x, A) < std::tie(Pts[B].y, Pts[B].x, B);
+    });
+  for (size_t i = 0; i < D; ++i)
+    YRank[YOrder[i]] = i;
+  for (size_t i = 0; i < D; ++i)
+    Perm[i] = YRank[XOrder[i]];
+
+  // Gaps between neighbouring x and then y coordinates.
+  std::array<Unit, 2 * (MaxLUTDegree - 1)> Gaps;
+  for (size_t i = 0; i + 1 < D; ++i) {
+    Gaps[i] = Pts[XOrder[i + 1]].x - Pts[XOrder[i]].x;
+    Gaps[D - 1 + i] = Pts[YOrder[i + 1]].y - Pts[YOrder[i]].y;
+  }
+
+  size_t Idx = getPermutationIndex(Perm.data(), D);
+  const uint8_t *Cur = Data[D] + Offsets[D][Idx];
+  size_t TopologiesNum = *Cur++;
+  const uint8_t *Best = nullptr;
+  Unit BestLen = 0;
+  for (size_t T = 0; T < TopologiesNum; ++T) {
+    Unit Len = 0;
+    for (size_t i = 0; i < 2 * (D - 1); ++i)
+      Len += Cur[i] * Gaps[i];
+    if (!Best || Len < BestLen) {
+      Best = Cur;
+      BestLen = Len;
+    }
+    size_t S = Cur[2 * (D - 1)];
+    Cur += 2 * (D - 1) + 1 + 2 * S + 2 * (D + S - 1);
+  }
+
+  Cur = Best + 2 * (D - 1);
+  size_t S = *Cur++;
+  for (size_t i = 0; i < S; ++i, Cur += 2)
+    G.push_vertice(Point(Pts[XOrder[Cur[0]]].x, Pts[YOrder[Cur[1]]].y));
+  auto getVertex = [&](size_t Node) -> size_t {
+    return Node < D ? XOrder[Node] : Node;
+  };
+  std::vector<Graph<Point>::EdgeType> Edges;
+  Edges.reserve(D + S - 1);
+  for (size_t i = 0, e = D + S - 1; i < e; ++i, Cur += 2) {
+    size_t From = getVertex(Cur[0]), To = getVertex(Cur[1]);
+    Edges.emplace_back(From, To, dist(G.vertice(From), G.vertice(To)));
+  }
+  G.swapEdges(Edges);
+  return G;
+}
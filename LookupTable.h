@@ -0,0 +1,57 @@
+#ifndef STEINER_LOOKUP_TABLE_H_DEFINED__
+#define STEINER_LOOKUP_TABLE_H_DEFINED__
+
+#include "MST.h"
+#include "MappedFile.h"
+#include "Net.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Table of precomputed trees for nets of low degree in the spirit of
+// FLUTE (C. Chu, Y.-C. Wong, "FLUTE: Fast lookup table based rectilinear
+// Steiner minimal tree algorithm for VLSI design").
+//
+// Pins of a net of degree D sorted by x get x ranks 0..D-1, sorted by y
+// they get y ranks. The net is classified by the permutation of y ranks
+// in x rank order. For each permutation the table keeps a few tree
+// topologies over the rank grid. Length of a topology is a linear
+// function of the gaps between neighbouring coordinates, so the table
+// stores its coefficients and the cheapest topology for the actual gaps
+// is picked with a few dot products.
+//
+// File format (little-endian, built by GenLUT):
+//   header:     "SLUT", version, max degree, 0 as uint32
+//   per degree: uint32 offsets of D! + 1 entries relative to the
+//               following data, the data padded to 4 bytes
+//   entry:      number of topologies, then each topology as bytes:
+//               2 (D - 1) coefficients of x and y gaps, number of
+//               Steiner points S, S pairs of their x and y ranks,
+//               D + S - 1 edges as pairs of nodes. Nodes 0..D-1 are
+//               pins in x rank order, the rest are Steiner points.
+constexpr uint32_t LUTVersion = 1;
+constexpr size_t MaxLUTDegree = 9;
+
+class SteinerLUT {
+  MappedFile File;
+  size_t MaxDegree = 0;
+  // Indexed by degree.
+  std::vector<const uint32_t *> Offsets;
+  std::vector<const uint8_t *> Data;
+
+public:
+  // Reports an error and exits if the file is not a valid table.
+  explicit SteinerLUT(const std::string &FName);
+
+  size_t getMaxDegree() const { return MaxDegree; }
+
+  // Tree for the net with at most getMaxDegree() pins. Pins are
+  // first N.size() vertices followed by Steiner points.
+  Graph<Point> route(const Net &N) const;
+};
+
+// Index of permutation of 0..Num-1 in lexicographic order.
+size_t getPermutationIndex(const uint8_t *Perm, size_t Num);
+
+#endif
@@ -1,89 +1,33 @@
 #include "MST.h"
+#include "StlHelpers.hpp"
 
 #include <algorithm>
-#include <iterator>
+#include <array>
+#include <map>
+#include <numeric>
 #include <utility>
 #include <vector>
 
 #include <cassert>
 
-// Helper structure for MST building.
-template<typename T>
-class DisjointSet {
-  struct Node {
-    Node *Parent;
-    size_t Size;
-    T Value;
-
-    template<typename U>
-    Node(U &&Val): Parent(this), Size(1), Value(std::forward<U>(Val)) {}
-
-    Node(Node &&N): Parent(this), Size(N.Size), Value(std::move(N.Value)) {
-      assert(N.Parent == &N && "Can handle only initialization cases");
-    }
-
-    Node(const Node &) = delete;
-    void operator=(Node) = delete;
-  };
-
-  Node This;
-
-  Node *findReprNode() {
-    Node *Cur = &This;
-    while (Cur->Parent != Cur) {
-      Cur = Cur->Parent;
-    }
-    This.Parent = Cur;
-    return Cur;
-  }
-
-public:
-  template<typename U>
-  DisjointSet(U &&Val): This(std::forward<U>(Val)) {}
-
-  void unite(DisjointSet &Other) {
-    Node *Lhs = findReprNode();
-    Node *Rhs = Other.findReprNode();
-    if (Lhs->Size < Rhs->Size) {
-      std::swap(Lhs, Rhs);
-    }
-
-    Rhs->Parent = Lhs;
-    Lhs->Size += Rhs->Size;
-  }
-
-  const T& findReprMember() {
-    return findReprNode()->Value;
-  }
-};
-
 using EdgeTy = typename Graph<Point>::EdgeType;
 
-// Assumes that graph edges are sorted by weight.
-template<typename InitAcc, typename UpdateAcc>
-auto getMSTCommon(const Graph<Point> &G, InitAcc Initializer, UpdateAcc Updater) {
-  std::vector<DisjointSet<int>> Segments;
-  Segments.reserve(G.vertices_size());
-  // Assign each segment it's own color.
-  std::generate_n(std::back_inserter(Segments), G.vertices_size(), [N = 0]() mutable {
-      int X = N;
-      ++N;
-      return X;
-    });
+// Assumes that edges are sorted by weight.
+template<typename EdgeRange, typename InitAcc, typename UpdateAcc>
+auto getMSTCommon(size_t VNum, const EdgeRange &Edges, UnionFind &Segments,
+                  InitAcc Initializer, UpdateAcc Updater) {
+  Segments.reset(VNum);
 
   // Pick an edge and update accumulator
   // if this edge is not in MST and unite segments.
   // Otherwise skip the edge.
   size_t AddedEdges = 0;
-  size_t MaxEdges = G.vertices_size() - 1;
+  size_t MaxEdges = VNum - 1;
 
   auto Accumulator = Initializer();
-  for (auto Edge : G.edges()) {
-    auto &FromSet = Segments[Edge.From];
-    auto &ToSet = Segments[Edge.To];
-    if (FromSet.findReprMember() == ToSet.findReprMember())
+  for (auto Edge : Edges) {
+    if (!Segments.unite(Edge.From, Edge.To))
       continue;
-    FromSet.unite(ToSet);
     Updater(Accumulator, std::move(Edge));
 
     ++AddedEdges;
@@ -94,23 +38,306 @@ auto getMSTCommon(const Graph<Point> &G, InitAcc Initializer, UpdateAcc Updater)
   return Accumulator;
 }
 
-Unit getMSTLen(const Graph<Point> &G) {
-  return getMSTCommon(G,
+Unit getMSTLen(const Graph<Point> &G, UnionFind &UF) {
+  return getMSTCommon(G.vertices_size(), G.edges(), UF,
                       []() -> Unit { return 0; },
                       [&](Unit &TotalLen, EdgeTy Edge) {
-                        TotalLen += dist(G.vertice(Edge.From), G.vertice(Edge.To));
+                        TotalLen += Edge.Weight;
                       });
 }
 
+void getMSTEdges(const Graph<Point> &G, UnionFind &UF,
+                 std::vector<EdgeTy> &Res) {
+  Res.clear();
+  getMSTCommon(G.vertices_size(), G.edges(), UF,
+               [&]() { return &Res; },
+               [](std::vector<EdgeTy> *Edges, EdgeTy Edge) {
+                 Edges->push_back(Edge);
+               });
+}
+
 std::vector<EdgeTy>
-getMSTEdges(const Graph<Point> &G) {
-  return getMSTCommon(G,
-                      [&]() -> std::vector<EdgeTy> {
-                        std::vector<EdgeTy> Edges;
-                        Edges.reserve(G.vertices_size() - 1);
-                        return Edges;
-                      },
-                      [&](std::vector<EdgeTy> &Edges, EdgeTy Edge) {
-                        Edges.emplace_back(std::move(Edge));
-                      });
+getMSTEdges(const Graph<Point> &G, UnionFind &UF) {
+  std::vector<EdgeTy> Edges;
+  Edges.reserve(G.vertices_size());
+  getMSTEdges(G, UF, Edges);
+  return Edges;
+}
+
+Unit getMSTLen(const Graph<Point> &G) {
+  UnionFind UF;
+  return getMSTLen(G, UF);
+}
+
+std::vector<EdgeTy> getMSTEdges(const Graph<Point> &G) {
+  UnionFind UF;
+  return getMSTEdges(G, UF);
+}
+
+void sortEdgesByWeight(std::vector<EdgeTy> &Edges, std::vector<EdgeTy> &Tmp) {
+  size_t Num = Edges.size();
+  // Insertion sort is faster for lists of new edges of a point.
+  if (Num <= 32) {
+    for (size_t i = 1; i < Num; ++i) {
+      EdgeTy E = Edges[i];
+      size_t j = i;
+      for (; j > 0 && Edges[j - 1].key() > E.key(); --j)
+        Edges[j] = Edges[j - 1];
+      Edges[j] = E;
+    }
+    return;
+  }
+
+  uint32_t AnyBits = 0, AllBits = ~uint32_t(0);
+  for (const EdgeTy &E : Edges) {
+    AnyBits |= E.key();
+    AllBits &= E.key();
+  }
+  uint32_t Varying = AnyBits ^ AllBits;
+
+  reserve_geometric(Tmp, Num);
+  Tmp.resize(Num);
+  for (unsigned Shift = 0; Shift < 32; Shift += 8) {
+    if (((Varying >> Shift) & 0xFF) == 0)
+      continue;
+    std::array<size_t, 256> Starts{};
+    for (const EdgeTy &E : Edges)
+      ++Starts[(E.key() >> Shift) & 0xFF];
+    size_t Sum = 0;
+    for (size_t &S : Starts) {
+      size_t Count = S;
+      S = Sum;
+      Sum += Count;
+    }
+    for (const EdgeTy &E : Edges)
+      Tmp[Starts[(E.key() >> Shift) & 0xFF]++] = E;
+    Edges.swap(Tmp);
+  }
+}
+
+void sortEdgesByWeight(Graph<Point> &G, std::vector<EdgeTy> &Tmp) {
+  std::vector<EdgeTy> Edges;
+  G.swapEdges(Edges);
+  sortEdgesByWeight(Edges, Tmp);
+  G.swapEdges(Edges);
+}
+
+void connectSpanningGraph(Graph<Point> &G) {
+  size_t PNum = G.vertices_size();
+  std::vector<Point> Pts(G.vertices_begin(), G.vertices_end());
+  std::vector<size_t> Order(PNum);
+  std::iota(Order.begin(), Order.end(), 0);
+
+  std::vector<EdgeTy> Edges;
+  Edges.reserve(4 * PNum);
+  // Active points keyed by negated y. Each active point has not
+  // found its closest neighbour in the swept octant yet.
+  std::map<Unit, size_t> Active;
+
+  // Each pass finds neighbours in one octant (and the opposite one
+  // by symmetry). Points are reflected between passes.
+  for (int Pass = 0; Pass < 4; ++Pass) {
+    std::sort(Order.begin(), Order.end(), [&](size_t A, size_t B) {
+        return Pts[A].x + Pts[A].y < Pts[B].x + Pts[B].y;
+      });
+    Active.clear();
+    for (size_t Idx : Order) {
+      Point Cur = Pts[Idx];
+      auto It = Active.lower_bound(-Cur.y);
+      while (It != Active.end()) {
+        Point Prev = Pts[It->second];
+        Unit XDiff = Cur.x - Prev.x;
+        Unit YDiff = Cur.y - Prev.y;
+        if (YDiff > XDiff)
+          break;
+        // Cur is the closest point in the octant of Prev.
+        Edges.emplace_back(It->second, Idx, dist(Prev, Cur));
+        It = Active.erase(It);
+      }
+      Active[-Cur.y] = Idx;
+    }
+
+    for (auto &P : Pts) {
+      if (Pass & 1)
+        P.x = -P.x;
+      else
+        std::swap(P.x, P.y);
+    }
+  }
+
+  G.swapEdges(Edges);
+}
+
+void PathMaxTree::reserve(size_t Num) {
+  size_t L = 1;
+  while ((size_t(1) << L) < Num)
+    ++L;
+  Depth.reserve(Num);
+  Up.reserve(L * Num);
+  MaxW.reserve(L * Num);
+  Offsets.reserve(Num + 1);
+  // A tree has less than Num edges.
+  Adj.reserve(2 * Num);
+  Fill.reserve(Num);
+  Stack.reserve(Num);
+  Visited.reserve(Num);
+}
+
+void PathMaxTree::build(const Graph<Point> &G) {
+  VNum = G.vertices_size();
+  Levels = 1;
+  while ((size_t(1) << Levels) < VNum)
+    ++Levels;
+
+  // Adjacency lists in compressed form.
+  assign_geometric(Offsets, VNum + 1, size_t(0));
+  for (auto Edge : G.edges()) {
+    ++Offsets[Edge.From + 1];
+    ++Offsets[Edge.To + 1];
+  }
+  std::partial_sum(Offsets.begin(), Offsets.end(), Offsets.begin());
+  reserve_geometric(Adj, Offsets.back());
+  Adj.resize(Offsets.back());
+  reserve_geometric(Fill, VNum);
+  Fill.assign(Offsets.begin(), Offsets.end() - 1);
+  for (auto Edge : G.edges()) {
+    Adj[Fill[Edge.From]++] = Edge.To;
+    Adj[Fill[Edge.To]++] = Edge.From;
+  }
+
+  assign_geometric(Depth, VNum, size_t(0));
+  assign_geometric(Up, Levels * VNum, size_t(0));
+  assign_geometric(MaxW, Levels * VNum, Unit(0));
+
+  // Traverse tree from vertex 0 and remember parents.
+  assign_geometric(Visited, VNum, false);
+  for (size_t Root = 0; Root < VNum; ++Root) {
+    if (Visited[Root])
+      continue;
+    Visited[Root] = true;
+    Up[Root] = Root;
+    Stack.push_back(Root);
+    while (!Stack.empty()) {
+      size_t V = Stack.back();
+      Stack.pop_back();
+      for (size_t i = Offsets[V], e = Offsets[V + 1]; i < e; ++i) {
+        size_t To = Adj[i];
+        if (Visited[To])
+          continue;
+        Visited[To] = true;
+        Depth[To] = Depth[V] + 1;
+        Up[To] = V;
+        MaxW[To] = dist(G.vertice(V), G.vertice(To));
+        Stack.push_back(To);
+      }
+    }
+  }
+
+  for (size_t L = 1; L < Levels; ++L) {
+    size_t Cur = L * VNum;
+    size_t Prev = Cur - VNum;
+    for (size_t V = 0; V < VNum; ++V) {
+      size_t Mid = Up[Prev + V];
+      Up[Cur + V] = Up[Prev + Mid];
+      MaxW[Cur + V] = std::max(MaxW[Prev + V], MaxW[Prev + Mid]);
+    }
+  }
+}
+
+Unit PathMaxTree::pathMax(size_t A, size_t B) const {
+  Unit Res = 0;
+  if (Depth[A] < Depth[B])
+    std::swap(A, B);
+
+  // Lift A to the depth of B.
+  size_t Diff = Depth[A] - Depth[B];
+  for (size_t L = 0; Diff != 0; ++L, Diff >>= 1) {
+    if (Diff & 1) {
+      Res = std::max(Res, MaxW[L * VNum + A]);
+      A = Up[L * VNum + A];
+    }
+  }
+  if (A == B)
+    return Res;
+
+  // Lift both to children of their common ancestor.
+  for (size_t L = Levels; L-- > 0;) {
+    size_t UA = Up[L * VNum + A];
+    size_t UB = Up[L * VNum + B];
+    if (UA != UB) {
+      Res = std::max({Res, MaxW[L * VNum + A], MaxW[L * VNum + B]});
+      A = UA;
+      B = UB;
+    }
+  }
+  return std::max({Res, MaxW[A], MaxW[B]});
+}
+
+namespace {
+// Kruskal for tiny graphs with at most 9 vertices.
+struct SmallEdge {
+  Unit Weight;
+  unsigned char From, To;
+};
+
+template<size_t N>
+Unit getSmallMST(std::array<SmallEdge, N> &Edges, size_t ENum, size_t VNum,
+                 SmallEdge *Used = nullptr) {
+  std::sort(Edges.begin(), Edges.begin() + ENum,
+            [](const SmallEdge &A, const SmallEdge &B) {
+              return A.Weight < B.Weight;
+            });
+  std::array<unsigned char, 9> Color;
+  for (size_t i = 0; i < VNum; ++i)
+    Color[i] = i;
+
+  Unit Len = 0;
+  size_t Added = 0;
+  for (size_t i = 0; i < ENum && Added + 1 < VNum; ++i) {
+    unsigned char CFrom = Color[Edges[i].From];
+    unsigned char CTo = Color[Edges[i].To];
+    if (CFrom == CTo)
+      continue;
+    for (size_t j = 0; j < VNum; ++j) {
+      if (Color[j] == CTo)
+        Color[j] = CFrom;
+    }
+    Len += Edges[i].Weight;
+    if (Used)
+      Used[Added] = Edges[i];
+    ++Added;
+  }
+  return Len;
+}
+} // end anonymous namespace
+
+Unit getExtendedMSTLen(const PathMaxTree &T, Unit TreeLen,
+                       const size_t *Neighbours, const Unit *Weights,
+                       size_t Num) {
+  assert(Num <= 8 && "Too many neighbours");
+  if (Num == 0)
+    return TreeLen;
+
+  // Tree paths between neighbours contracted to single edges.
+  std::array<SmallEdge, 28> Paths;
+  size_t PNum = 0;
+  for (size_t i = 0; i < Num; ++i) {
+    for (size_t j = i + 1; j < Num; ++j) {
+      Paths[PNum++] = {T.pathMax(Neighbours[i], Neighbours[j]),
+                       static_cast<unsigned char>(i),
+                       static_cast<unsigned char>(j)};
+    }
+  }
+  // Only edges of this MST can be dropped from the tree.
+  std::array<SmallEdge, 15> Reduced;
+  Unit PathsLen = getSmallMST(Paths, PNum, Num, Reduced.data());
+
+  // New vertex gets index Num.
+  size_t RNum = Num - 1;
+  for (size_t i = 0; i < Num; ++i) {
+    Reduced[RNum++] = {Weights[i], static_cast<unsigned char>(i),
+                       static_cast<unsigned char>(Num)};
+  }
+  Unit NewLen = getSmallMST(Reduced, RNum, Num + 1);
+  return TreeLen - PathsLen + NewLen;
 }
@@ -2,9 +2,15 @@
 #define STEINER_MST_H_DEFINED__
 
 #include "Net.h"
+#include "StlHelpers.hpp"
 #include "Types.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 template<typename It>
@@ -24,11 +30,19 @@ Range(It B, It E) -> Range<It>;
 template<typename T>
 class Graph {
 public:
+  // Endpoints are 32-bit and the weight is cached, so sorting and
+  // Kruskal never touch vertices.
   struct EdgeType {
-    size_t From, To;
+    uint32_t From, To;
+    Unit Weight;
 
     EdgeType() = default;
-    EdgeType(size_t from, size_t to): From(from), To(to) {}
+    EdgeType(size_t from, size_t to, Unit weight):
+      From(static_cast<uint32_t>(from)), To(static_cast<uint32_t>(to)),
+      Weight(weight) {}
+
+    // Edges are sorted by this key. Weights are never negative.
+    uint32_t key() const { return static_cast<uint32_t>(Weight); }
 
     bool operator==(const EdgeType &O) {
       return std::tie(From, To) == std::tie(O.From, O.To);
@@ -38,6 +52,14 @@ public:
     }
   };
 
+  // Index of a removed vertex in remaps.
+  static constexpr size_t NoVertex = std::numeric_limits<size_t>::max();
+
+  // Scratch memory of dedupeEdges.
+  struct DedupeScratch {
+    std::vector<uint32_t> Offsets, Order, Seen;
+  };
+
 private:
   using ECTy = std::vector<EdgeType>;
   using VCTy = std::vector<T>;
@@ -56,7 +78,7 @@ public:
     Edges.reserve(PNum * PNum);
     for (size_t i = 0; i < PNum; ++i) {
       for (size_t j = i + 1; j < PNum; ++j) {
-        Edges.emplace_back(i, j);
+        Edges.emplace_back(i, j, dist(Vertices[i], Vertices[j]));
       }
     }
   }
@@ -85,6 +107,8 @@ public:
     return Edges.erase(First, Last);
   }
 
+  void edges_reserve(size_t Num) { Edges.reserve(Num); }
+
   T &vertice(size_t Idx) { return Vertices[Idx]; }
   const T &vertice(size_t Idx) const { return Vertices[Idx]; }
 
@@ -93,6 +117,7 @@ public:
   auto vertices_end() { return Vertices.end(); }
   auto vertices_end() const { return Vertices.end(); }
   auto vertices_size() const { return Vertices.size(); }
+  void vertices_reserve(size_t Num) { Vertices.reserve(Num); }
 
   auto vertices_erase(typename VCTy::const_iterator It) {
     return Vertices.erase(It);
@@ -124,6 +149,69 @@ public:
   }
 
 
+  // Remove vertices with Keep[i] == false and all edges incident to them
+  // in one pass over vertices and one over edges. The rest of vertices and
+  // edges keep their order. OldToNew gets the new index of each vertex
+  // or NoVertex if it was removed.
+  void compact(const std::vector<bool> &Keep, std::vector<size_t> &OldToNew) {
+    reserve_geometric(OldToNew, Vertices.size());
+    OldToNew.resize(Vertices.size());
+    size_t New = 0;
+    for (size_t i = 0, e = Vertices.size(); i < e; ++i) {
+      if (!Keep[i]) {
+        OldToNew[i] = NoVertex;
+        continue;
+      }
+      OldToNew[i] = New;
+      if (New != i)
+        Vertices[New] = std::move(Vertices[i]);
+      ++New;
+    }
+    Vertices.erase(Vertices.begin() + New, Vertices.end());
+
+    size_t ENew = 0;
+    for (EdgeType E : Edges) {
+      size_t From = OldToNew[E.From], To = OldToNew[E.To];
+      if (From == NoVertex || To == NoVertex)
+        continue;
+      Edges[ENew++] = EdgeType(From, To, E.Weight);
+    }
+    Edges.erase(Edges.begin() + ENew, Edges.end());
+  }
+
+  // Remove repeated edges in either direction and self-loops. The first
+  // copy of each edge is kept in place. Edges are bucketed by the smaller
+  // endpoint with counting sort instead of sorting, so it is O(V + E).
+  void dedupeEdges(DedupeScratch &S) {
+    size_t VNum = Vertices.size();
+    assign_geometric(S.Offsets, VNum + 1, uint32_t(0));
+    for (const EdgeType &E : Edges)
+      ++S.Offsets[std::min(E.From, E.To) + 1];
+    std::partial_sum(S.Offsets.begin(), S.Offsets.end(), S.Offsets.begin());
+    reserve_geometric(S.Order, Edges.size());
+    S.Order.resize(Edges.size());
+    for (uint32_t i = 0, e = Edges.size(); i < e; ++i)
+      S.Order[S.Offsets[std::min(Edges[i].From, Edges[i].To)]++] = i;
+
+    // Now bucket of V ends at Offsets[V]. Seen[U] == V + 1 if edge V-U
+    // was already met. Duplicates are turned into self-loops.
+    assign_geometric(S.Seen, VNum, uint32_t(0));
+    for (uint32_t V = 0, Begin = 0; V < VNum; Begin = S.Offsets[V++]) {
+      for (uint32_t i = Begin, e = S.Offsets[V]; i < e; ++i) {
+        EdgeType &E = Edges[S.Order[i]];
+        uint32_t U = std::max(E.From, E.To);
+        if (U == V || S.Seen[U] == V + 1)
+          E.To = E.From;
+        else
+          S.Seen[U] = V + 1;
+      }
+    }
+    Edges.erase(std::remove_if(Edges.begin(), Edges.end(),
+                               [](const EdgeType &E) {
+                                 return E.From == E.To;
+                               }), Edges.end());
+  }
+
   void dump() const {
     std::cout << "Vertices:" << std::endl;
     for (size_t i = 0, e = Vertices.size(); i < e; ++i) {
@@ -132,15 +220,139 @@ public:
     std::cout << "Edges:" << std::endl;
     for (auto E : Edges) {
       std::cout << E.From << " -> " << E.To << ": ";
-      std::cout << dist(vertice(E.From), vertice(E.To)) << std::endl;
+      std::cout << E.Weight << std::endl;
     }
   }
 
   // TODO: add methods for working with edges and vertices?
 };
 
+// Disjoint sets of vertex indices with union by rank and path halving.
+// Meant to be allocated once: reset() restores singletons in time
+// proportional to the number of sets merged since the previous reset.
+class UnionFind {
+  std::vector<size_t> Parent;
+  std::vector<unsigned char> Rank;
+  // Vertices whose Parent or Rank differ from the initial ones.
+  std::vector<size_t> Touched;
+
+public:
+  UnionFind() = default;
+  explicit UnionFind(size_t Size) { reset(Size); }
+
+  // Make sure reset(Size) and following unites don't allocate.
+  void reserve(size_t Size) {
+    Parent.reserve(Size);
+    Rank.reserve(Size);
+    Touched.reserve(2 * Size);
+  }
+
+  // Make [0, Size) singletons.
+  void reset(size_t Size) {
+    for (size_t V : Touched) {
+      Parent[V] = V;
+      Rank[V] = 0;
+    }
+    Touched.clear();
+    if (Size > Parent.size()) {
+      size_t Old = Parent.size();
+      Parent.resize(Size);
+      Rank.resize(Size, 0);
+      std::iota(Parent.begin() + Old, Parent.end(), Old);
+    }
+  }
+
+  size_t find(size_t V) {
+    while (Parent[V] != V) {
+      // Path halving: point to grandparent and jump there. Only
+      // vertices which are already in Touched are changed.
+      Parent[V] = Parent[Parent[V]];
+      V = Parent[V];
+    }
+    return V;
+  }
+
+  // Returns false if A and B are already in the same set.
+  bool unite(size_t A, size_t B) {
+    A = find(A);
+    B = find(B);
+    if (A == B)
+      return false;
+    if (Rank[A] < Rank[B])
+      std::swap(A, B);
+    Parent[B] = A;
+    Touched.push_back(B);
+    if (Rank[A] == Rank[B]) {
+      ++Rank[A];
+      Touched.push_back(A);
+    }
+    return true;
+  }
+};
+
+// Stable LSD radix sort of edges by weight. Tmp is a buffer of the same
+// type, Edges and Tmp may exchange their memory. Passes over bytes which
+// are equal in all weights are skipped, so usually there are one or two.
+void sortEdgesByWeight(std::vector<typename Graph<Point>::EdgeType> &Edges,
+                       std::vector<typename Graph<Point>::EdgeType> &Tmp);
+void sortEdgesByWeight(Graph<Point> &G,
+                       std::vector<typename Graph<Point>::EdgeType> &Tmp);
+
+// Kruskal over edges of G, which should be sorted by weight. UF is
+// reset and used as scratch space, so callers evaluating many graphs
+// can keep one and avoid allocations.
+Unit getMSTLen(const Graph<Point> &G, UnionFind &UF);
 Unit getMSTLen(const Graph<Point> &G);
 
+std::vector<typename Graph<Point>::EdgeType>
+getMSTEdges(const Graph<Point> &G, UnionFind &UF);
+// Puts MST edges into Res reusing its memory.
+void getMSTEdges(const Graph<Point> &G, UnionFind &UF,
+                 std::vector<typename Graph<Point>::EdgeType> &Res);
 std::vector<typename Graph<Point>::EdgeType>
 getMSTEdges(const Graph<Point> &G);
+
+// Connect each vertex with the closest vertex in each octant around it.
+// Such rectilinear spanning graph contains a MST of G vertices and has
+// at most 4n edges. Built with sweep-line in O(n log n) time
+// (H. Zhou, N. Shenoy, W. Nicholls, "Efficient minimum spanning tree
+// construction without Delaunay triangulation").
+void connectSpanningGraph(Graph<Point> &G);
+
+// Answers "maximum edge weight on the path between two vertices"
+// queries for a tree using binary lifting. Build is O(n log n),
+// query is O(log n). Read-only after build so it can be shared
+// between threads.
+class PathMaxTree {
+  size_t VNum = 0;
+  size_t Levels = 0;
+  std::vector<size_t> Depth;
+  // Ancestor 2^l levels above vertex v is Up[l * VNum + v],
+  // MaxW[l * VNum + v] is the heaviest edge on the way to it.
+  std::vector<size_t> Up;
+  std::vector<Unit> MaxW;
+
+  // Scratch space of build(), kept to avoid allocations on rebuilds.
+  std::vector<size_t> Offsets, Adj, Fill, Stack;
+  std::vector<bool> Visited;
+
+public:
+  PathMaxTree() = default;
+
+  // Make sure builds for trees with up to VNum vertices don't allocate.
+  void reserve(size_t VNum);
+
+  // G should be a tree.
+  void build(const Graph<Point> &G);
+
+  Unit pathMax(size_t A, size_t B) const;
+};
+
+// Length of MST of a tree with total length TreeLen extended with a new
+// vertex connected to Neighbours[i] by edge of weight Weights[i].
+// Only tree paths between neighbours can change, so it is enough to run
+// Kruskal over neighbours using path maximums as distances between them.
+Unit getExtendedMSTLen(const PathMaxTree &T, Unit TreeLen,
+                       const size_t *Neighbours, const Unit *Weights,
+                       size_t Num);
 #endif
@@ -0,0 +1,40 @@
+#include "MappedFile.h"
+#include "Support.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &FName) {
+  int FD = open(FName.c_str(), O_RDONLY);
+  if (FD < 0)
+    report_error("Can't open file '", FName, "': ", strerror(errno), ".\n");
+
+  struct stat St;
+  if (fstat(FD, &St) != 0) {
+    close(FD);
+    report_error("Can't read file '", FName, "': ", strerror(errno), ".\n");
+  }
+
+  Size = St.st_size;
+  // Empty files can't be mapped.
+  if (Size != 0) {
+    void *Ptr = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, FD, 0);
+    if (Ptr == MAP_FAILED) {
+      close(FD);
+      report_error("Can't map file '", FName, "': ", strerror(errno), ".\n");
+    }
+    madvise(Ptr, Size, MADV_SEQUENTIAL);
+    Data = static_cast<const char *>(Ptr);
+  }
+  close(FD);
+}
+
+MappedFile::~MappedFile() {
+  if (Data)
+    munmap(const_cast<char *>(Data), Size);
+}
@@ -0,0 +1,24 @@
+#ifndef STEINER_MAPPED_FILE_H_DEFINED__
+#define STEINER_MAPPED_FILE_H_DEFINED__
+
+#include <string>
+
+// Read-only view of the whole file mapped into memory.
+class MappedFile {
+  const char *Data = nullptr;
+  size_t Size = 0;
+
+public:
+  // Reports an error and exits if file can't be mapped.
+  explicit MappedFile(const std::string &FName);
+
+  MappedFile(const MappedFile &) = delete;
+  void operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  const char *begin() const { return Data; }
+  const char *end() const { return Data + Size; }
+  size_t size() const { return Size; }
+};
+
+#endif
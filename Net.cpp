@@ -1,7 +1,7 @@
 #include "Net.h"
+#include "XmlWriter.h"
 
 #include <algorithm>
-#include <iostream>
 
 void Net::addConnection(Point From, Point To) {
   Unit XDiff = std::abs(From.x - To.x);
@@ -12,7 +12,6 @@ void Net::addConnection(Point From, Point To) {
     Unit XB = From.x;
     Unit XE = To.x;
     // Order from minimal x to maximal.
-    // Needed for later removal of zero-length segments.
     if (From.x > To.x)
       std::swap(XB, XE);
     HorSeg.emplace_back(Point(XB, From.y), Point(XE, From.y));
@@ -32,27 +31,46 @@ void Net::addConnection(Point From, Point To) {
   }
 }
 
+// Union collinear segments of one layer. Segments lie on tracks where
+// coordinate Track is fixed and span along coordinate Along. Overlapping
+// and touching segments of a track are merged into one, zero-length
+// segments inside others disappear the same way. O(S log S).
+static void mergeSegments(std::vector<std::pair<Point, Point>> &Segs,
+                          Unit Point::*Track, Unit Point::*Along) {
+  for (auto &S : Segs) {
+    if (S.second.*Along < S.first.*Along)
+      std::swap(S.first, S.second);
+  }
+  std::sort(Segs.begin(), Segs.end(), [&](const auto &A, const auto &B) {
+      return std::tie(A.first.*Track, A.first.*Along, A.second.*Along) <
+             std::tie(B.first.*Track, B.first.*Along, B.second.*Along);
+    });
+
+  size_t Out = 0;
+  for (size_t i = 0, e = Segs.size(); i < e; ++i) {
+    if (Out != 0) {
+      auto &Last = Segs[Out - 1];
+      if (Last.first.*Track == Segs[i].first.*Track &&
+          Segs[i].first.*Along <= Last.second.*Along) {
+        if (Last.second.*Along < Segs[i].second.*Along)
+          Last.second = Segs[i].second;
+        continue;
+      }
+    }
+    Segs[Out++] = Segs[i];
+  }
+  Segs.erase(Segs.begin() + Out, Segs.end());
+}
+
 // Remove duplicates in transitions layers.
 void Net::finalizeNet() {
   // Remove excess transitions form m3 to m2.
   std::sort(M23Trans.begin(), M23Trans.end());
   M23Trans.erase(std::unique(M23Trans.begin(), M23Trans.end()), M23Trans.end());
 
-  // Remove duplicates of horizontal segments.
-  std::sort(HorSeg.begin(), HorSeg.end());
-  HorSeg.erase(std::unique(HorSeg.begin(), HorSeg.end()), HorSeg.end());
-
-  // Remove excess zero-length horizonal segments (covered by non-zero ones).
-  auto PartIt = std::partition(HorSeg.begin(), HorSeg.end(), [](const Segment &S) {
-      return S.first.x != S.second.x;
-    });
-  auto RmIt = std::remove_if(PartIt, HorSeg.end(), [&](const Segment &ZeroSeg) {
-      return std::any_of(HorSeg.begin(), PartIt, [&ZeroSeg](const Segment &S) {
-          Unit ZX = ZeroSeg.first.x;
-          return S.first.y == ZeroSeg.first.y && S.first.x <= ZX && ZX <= S.second.x;
-        });
-    });
-  HorSeg.erase(RmIt, HorSeg.end());
+  // Merge horizontal segments on m2 by y and vertical ones on m3 by x.
+  mergeSegments(HorSeg, &Point::y, &Point::x);
+  mergeSegments(VertSeg, &Point::x, &Point::y);
 }
 
 enum PtType {
@@ -68,80 +86,72 @@ enum Layer {
   M3
 };
 
-static void
-dumpLayer(std::ostream &O, Layer L) {
+static const char *getLayerName(Layer L) {
   switch (L) {
   case Pins:
-    O << "pins";
-    break;
+    return "pins";
   case Pins_M2:
-    O << "pins_m2";
-    break;
+    return "pins_m2";
   case M2:
-    O << "m2";
-    break;
+    return "m2";
   case M2_M3:
-    O << "m2_m3";
-    break;
+    return "m2_m3";
   case M3:
-    O << "m3";
-    break;
+    return "m3";
   }
+  return "";
 }
 
 static void
-dumpPoint(std::ostream &O, Point P, PtType PType, Layer PLayer) {
-  O << "<point x=\"" << P.x << "\" y=\"" << P.y << "\" ";
-  O << "layer=\"";
-  dumpLayer(O, PLayer);
-  O << "\" type=\"";
-  switch (PType) {
-  case Pin:
-    O << "pin";
-    break;
-  case ViaPin:
-    O << "via";
-    break;
-  }
-  O << "\" />" << std::endl;
+dumpPoint(XmlWriter &W, Point P, PtType PType, Layer PLayer) {
+  W.indent(2);
+  W << "<point x=\"" << P.x << "\" y=\"" << P.y << "\" ";
+  W << "layer=\"" << getLayerName(PLayer);
+  W << "\" type=\"" << (PType == Pin ? "pin" : "via") << "\" />";
+  W.newline();
 }
 
 static void
-dumpSegment(std::ostream &O, Point P1, Point P2, Layer L) {
-  O << "<segment ";
-  O << "x1=\"" << P1.x << "\" y1=\"" << P1.y << "\" ";
-  O << "x2=\"" << P2.x << "\" y2=\"" << P2.y << "\" ";
-  O << "layer=\"";
-  dumpLayer(O, L);
-  O << "\" />" << std::endl;
+dumpSegment(XmlWriter &W, Point P1, Point P2, Layer L) {
+  W.indent(2);
+  W << "<segment ";
+  W << "x1=\"" << P1.x << "\" y1=\"" << P1.y << "\" ";
+  W << "x2=\"" << P2.x << "\" y2=\"" << P2.y << "\" ";
+  W << "layer=\"" << getLayerName(L) << "\" />";
+  W.newline();
 }
 
-void Net::dumpXML(std::ostream &O) const {
-  O << "<root>" << std::endl;
-  O << "  <grid min_x=\"" << LBCorner.x << "\" max_x=\"" << RUCorner.x;
-  O << "\" min_y=\"" << LBCorner.y << "\" max_y=\"" << RUCorner.y << "\" />" << std::endl;
-  O << "  <net>" << std::endl;
-  for (const auto P : Pts) {
-    O << "    ";
-    dumpPoint(O, P, Pin, Pins);
-  }
+void Net::dumpXML(XmlWriter &W) const {
+  W << "<root>";
+  W.newline();
+  dumpXMLGrid(W);
+  dumpXMLNet(W);
+  W << "</root>\n";
+}
+
+void Net::dumpXMLGrid(XmlWriter &W) const {
+  W.indent(1);
+  W << "<grid min_x=\"" << LBCorner.x << "\" max_x=\"" << RUCorner.x;
+  W << "\" min_y=\"" << LBCorner.y << "\" max_y=\"" << RUCorner.y << "\" />";
+  W.newline();
+}
+
+void Net::dumpXMLNet(XmlWriter &W) const {
+  W.indent(1);
+  W << "<net>";
+  W.newline();
+  for (const auto P : Pts)
+    dumpPoint(W, P, Pin, Pins);
   // Lift pins to m2 layer as vias.
-  for (const auto P : Pts) {
-    O << "    ";
-    dumpPoint(O, P, ViaPin, Pins_M2);
-  }
-  for (const auto P : M23Trans) {
-    O << "    ";
-    dumpPoint(O, P, ViaPin, M2_M3);
-  }
-  for (const auto &S : VertSeg) {
-    O << "    ";
-    dumpSegment(O, S.first, S.second, M3);
-  }
-  for (const auto &S : HorSeg) {
-    O << "    ";
-    dumpSegment(O, S.first, S.second, M2);
-  }
-  O << "  </net>" << std::endl;
-  O << "</root>" << std::endl;
+  for (const auto P : Pts)
+    dumpPoint(W, P, ViaPin, Pins_M2);
+  for (const auto P : M23Trans)
+    dumpPoint(W, P, ViaPin, M2_M3);
+  for (const auto &S : VertSeg)
+    dumpSegment(W, S.first, S.second, M3);
+  for (const auto &S : HorSeg)
+    dumpSegment(W, S.first, S.second, M2);
+  W.indent(1);
+  W << "</net>";
+  W.newline();
 }
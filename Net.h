@@ -8,6 +8,8 @@
 #include <tuple>
 #include <vector>
 
+class XmlWriter;
+
 struct Point {
   Unit x = 0, y = 0;
   Point() = default;
@@ -40,8 +42,10 @@ std::ostream &operator<<(std::ostream &Out, Point Pt) {
 }
 
 class Net {
+public:
   using Segment = std::pair<Point, Point>;
 
+private:
   std::vector<Point> Pts;
   std::vector<Segment> VertSeg;
   std::vector<Segment> HorSeg;
@@ -88,9 +92,25 @@ public:
 
   void addConnection(Point From, Point To);
 
-  // Remove duplicates in transitions layers.
+  Point getLBCorner() const { return LBCorner; }
+  Point getRUCorner() const { return RUCorner; }
+
+  // Routed geometry as it is stored in output files: m2-m3 vias,
+  // horizontal m2 and vertical m3 segments.
+  void addVia(Point P) { M23Trans.push_back(P); }
+  void addHorSegment(Point B, Point E) { HorSeg.emplace_back(B, E); }
+  void addVertSegment(Point B, Point E) { VertSeg.emplace_back(B, E); }
+  const std::vector<Point> &vias() const { return M23Trans; }
+  const std::vector<Segment> &horSegments() const { return HorSeg; }
+  const std::vector<Segment> &vertSegments() const { return VertSeg; }
+
+  // Remove duplicate vias and merge collinear segments of each layer.
   void finalizeNet();
-  void dumpXML(std::ostream &O) const;
+  // Whole document with this net only.
+  void dumpXML(XmlWriter &W) const;
+  // Separate parts of the document to put several nets in one file.
+  void dumpXMLGrid(XmlWriter &W) const;
+  void dumpXMLNet(XmlWriter &W) const;
 };
 
 [[maybe_unused]] static
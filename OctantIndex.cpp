@@ -0,0 +1,297 @@
+#include "OctantIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if !defined(STEINER_NO_SIMD) && (defined(__AVX512F__) || defined(__AVX2__))
+#define STEINER_SIMD_OCTANTS
+#include <immintrin.h>
+#endif
+
+// Vector scan pays off on longer ranges, so buckets hold about one
+// vector of points.
+#if defined(STEINER_SIMD_OCTANTS) && defined(__AVX512F__)
+constexpr double PointsPerBucket = 16;
+#elif defined(STEINER_SIMD_OCTANTS)
+constexpr double PointsPerBucket = 8;
+#else
+constexpr double PointsPerBucket = 2;
+#endif
+
+size_t OctantIndex::getCol(Unit X) const {
+  if (X <= LB.x)
+    return 0;
+  return std::min<size_t>((X - LB.x) / CellW, Cols - 1);
+}
+
+size_t OctantIndex::getRow(Unit Y) const {
+  if (Y <= LB.y)
+    return 0;
+  return std::min<size_t>((Y - LB.y) / CellH, Rows - 1);
+}
+
+void OctantIndex::reset(Point InLB, Point RU, size_t ExpectedPts) {
+  LB = InLB;
+  Unit W = RU.x - LB.x + 1;
+  Unit H = RU.y - LB.y + 1;
+  // Buckets are close to squares. If the box is thinner than a square,
+  // the cells span it and the other side takes the whole budget.
+  double Cells2 = std::max<double>(1, ExpectedPts / PointsPerBucket);
+  double Area = static_cast<double>(W) * H / Cells2;
+  double Side = std::sqrt(Area);
+  CellW = std::max<Unit>(1, std::min<double>(W, Side));
+  CellH = std::max<Unit>(1, std::min<double>(H, Side));
+  if (CellW == W)
+    CellH = std::max<Unit>(1, std::min<double>(H, Area / CellW));
+  else if (CellH == H)
+    CellW = std::max<Unit>(1, std::min<double>(W, Area / CellH));
+  Cols = (W + CellW - 1) / CellW;
+  Rows = (H + CellH - 1) / CellH;
+  Starts.assign(Cols * Rows + 1, 0);
+  Xs.clear();
+  Ys.clear();
+  Idxs.clear();
+  // Points come and go during rounds; with some room this doesn't allocate.
+  Xs.reserve(ExpectedPts);
+  Ys.reserve(ExpectedPts);
+  Idxs.reserve(ExpectedPts);
+}
+
+void OctantIndex::assign(const Point *Pts, size_t Num) {
+  assert(Num <= INT32_MAX && "Too many points");
+  // Counting sort by bucket.
+  std::fill(Starts.begin(), Starts.end(), 0);
+  for (size_t i = 0; i < Num; ++i)
+    ++Starts[getCell(Pts[i]) + 1];
+  for (size_t i = 1, e = Starts.size(); i < e; ++i)
+    Starts[i] += Starts[i - 1];
+  Xs.resize(Num);
+  Ys.resize(Num);
+  Idxs.resize(Num);
+  for (size_t i = 0; i < Num; ++i) {
+    // Starts[c] moves to the start of bucket c + 1, so shifting
+    // Starts by one restores it after all points are placed.
+    size_t Pos = Starts[getCell(Pts[i])]++;
+    Xs[Pos] = Pts[i].x;
+    Ys[Pos] = Pts[i].y;
+    Idxs[Pos] = i;
+  }
+  std::rotate(Starts.begin(), Starts.end() - 1, Starts.end());
+  Starts[0] = 0;
+}
+
+void OctantIndex::insert(size_t Idx, Point P) {
+  assert(Idx < INT32_MAX && "Too many points");
+  size_t Cell = getCell(P);
+  size_t Pos = Starts[Cell + 1];
+  Xs.insert(Xs.begin() + Pos, P.x);
+  Ys.insert(Ys.begin() + Pos, P.y);
+  Idxs.insert(Idxs.begin() + Pos, Idx);
+  for (size_t i = Cell + 1, e = Starts.size(); i < e; ++i)
+    ++Starts[i];
+}
+
+void OctantIndex::erase(size_t Idx, Point P) {
+  size_t Cell = getCell(P);
+  auto B = Idxs.begin() + Starts[Cell];
+  auto E = Idxs.begin() + Starts[Cell + 1];
+  auto It = std::find(B, E, Idx);
+  if (It == E)
+    return;
+  size_t Pos = It - Idxs.begin();
+  Xs.erase(Xs.begin() + Pos);
+  Ys.erase(Ys.begin() + Pos);
+  Idxs.erase(It);
+  for (size_t i = Cell + 1, e = Starts.size(); i < e; ++i)
+    --Starts[i];
+}
+
+void OctantIndex::renumber(const std::vector<size_t> &OldToNew) {
+  size_t Out = 0;
+  for (size_t Cell = 0, e = Starts.size() - 1; Cell < e; ++Cell) {
+    size_t B = Starts[Cell], E = Starts[Cell + 1];
+    Starts[Cell] = Out;
+    for (size_t i = B; i < E; ++i) {
+      size_t New = OldToNew[Idxs[i]];
+      if (New == OctantNeighbours::NoPoint)
+        continue;
+      Xs[Out] = Xs[i];
+      Ys[Out] = Ys[i];
+      Idxs[Out] = New;
+      ++Out;
+    }
+  }
+  Starts.back() = Out;
+  Xs.resize(Out);
+  Ys.resize(Out);
+  Idxs.resize(Out);
+}
+
+namespace {
+// Scans ranges of points and keeps the closest point of each octant
+// in Res. Vector versions compute distances and octants of 8 or 16
+// points without branches (bit 0 of octant is YDiff < 0, bit 1 is
+// XDiff < 0 and bit 2 is (XDiff < YDiff) xor bit 0, as in getOctant)
+// and compare them with the current distance of their octants fetched
+// with a permutation. Only points that may be better go to the scalar
+// update, which is rare after the first few points.
+class OctantScanner {
+  Point This;
+  OctantNeighbours &Res;
+
+  void scanScalar(const Unit *X, const Unit *Y, const uint32_t *I,
+                  size_t Num) {
+    for (size_t i = 0; i < Num; ++i)
+      Res.update(This, Point(X[i], Y[i]), I[i]);
+  }
+
+  // Update Res with points of Mask, their distances are in D
+  // and octants in Oct.
+  void updateMasked(unsigned Mask, const int32_t *D, const int32_t *Oct,
+                    const uint32_t *I) {
+    for (; Mask; Mask &= Mask - 1) {
+      unsigned L = __builtin_ctz(Mask);
+      Res.update(Oct[L], D[L], I[L]);
+    }
+  }
+
+public:
+  OctantScanner(Point This, OctantNeighbours &Res): This(This), Res(Res) {}
+
+#if defined(STEINER_SIMD_OCTANTS) && defined(__AVX512F__)
+  void scan(const Unit *X, const Unit *Y, const uint32_t *I, size_t Num) {
+    constexpr size_t Width = 16;
+    const __m512i Zero = _mm512_setzero_si512();
+    const __m512i TX = _mm512_set1_epi32(This.x);
+    const __m512i TY = _mm512_set1_epi32(This.y);
+    for (size_t i = 0; i < Num; i += Width) {
+      __mmask16 Valid = Num - i >= Width ? 0xFFFF : (1u << (Num - i)) - 1;
+      __m512i XDiff = _mm512_sub_epi32(TX, _mm512_maskz_loadu_epi32(Valid, X + i));
+      __m512i YDiff = _mm512_sub_epi32(TY, _mm512_maskz_loadu_epi32(Valid, Y + i));
+      // Zero-masked forms, the plain ones pass undefined values through
+      // and GCC 12 warns about them.
+      __m512i D = _mm512_add_epi32(_mm512_maskz_abs_epi32(Valid, XDiff),
+                                   _mm512_maskz_abs_epi32(Valid, YDiff));
+      __mmask16 B0 = _mm512_cmplt_epi32_mask(YDiff, Zero);
+      __mmask16 B1 = _mm512_cmplt_epi32_mask(XDiff, Zero);
+      __mmask16 B2 = _mm512_cmplt_epi32_mask(XDiff, YDiff) ^ B0;
+      __m512i Oct = _mm512_maskz_mov_epi32(B0, _mm512_set1_epi32(1));
+      Oct = _mm512_mask_or_epi32(Oct, B1, Oct, _mm512_set1_epi32(2));
+      Oct = _mm512_mask_or_epi32(Oct, B2, Oct, _mm512_set1_epi32(4));
+      // Current distance of octant of each point.
+      __m512i Cur = _mm512_maskz_permutexvar_epi32(
+        Valid, Oct, _mm512_maskz_loadu_epi32(0xFF, Res.Dists.data()));
+      __mmask16 Mask = Valid & _mm512_cmple_epi32_mask(D, Cur);
+      if (!Mask)
+        continue;
+      alignas(64) int32_t DA[Width], OctA[Width];
+      _mm512_store_si512(DA, D);
+      _mm512_store_si512(OctA, Oct);
+      updateMasked(Mask, DA, OctA, I + i);
+    }
+  }
+
+#elif defined(STEINER_SIMD_OCTANTS)
+  void scan(const Unit *X, const Unit *Y, const uint32_t *I, size_t Num) {
+    constexpr size_t Width = 8;
+    const __m256i Zero = _mm256_setzero_si256();
+    const __m256i TX = _mm256_set1_epi32(This.x);
+    const __m256i TY = _mm256_set1_epi32(This.y);
+    size_t i = 0;
+    for (; i + Width <= Num; i += Width) {
+      __m256i XDiff = _mm256_sub_epi32(
+        TX, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(X + i)));
+      __m256i YDiff = _mm256_sub_epi32(
+        TY, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Y + i)));
+      __m256i D = _mm256_add_epi32(_mm256_abs_epi32(XDiff), _mm256_abs_epi32(YDiff));
+      __m256i B0 = _mm256_cmpgt_epi32(Zero, YDiff);
+      __m256i B1 = _mm256_cmpgt_epi32(Zero, XDiff);
+      __m256i B2 = _mm256_xor_si256(_mm256_cmpgt_epi32(YDiff, XDiff), B0);
+      __m256i Oct = _mm256_or_si256(
+        _mm256_and_si256(B0, _mm256_set1_epi32(1)),
+        _mm256_or_si256(_mm256_and_si256(B1, _mm256_set1_epi32(2)),
+                        _mm256_and_si256(B2, _mm256_set1_epi32(4))));
+      // Current distance of octant of each point.
+      __m256i Cur = _mm256_permutevar8x32_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Res.Dists.data())),
+        Oct);
+      // D <= Cur.
+      unsigned Mask = _mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpgt_epi32(D, Cur),
+                                             _mm256_set1_epi32(-1))));
+      if (!Mask)
+        continue;
+      alignas(32) int32_t DA[Width], OctA[Width];
+      _mm256_store_si256(reinterpret_cast<__m256i *>(DA), D);
+      _mm256_store_si256(reinterpret_cast<__m256i *>(OctA), Oct);
+      updateMasked(Mask, DA, OctA, I + i);
+    }
+    scanScalar(X + i, Y + i, I + i, Num - i);
+  }
+
+#else
+  void scan(const Unit *X, const Unit *Y, const uint32_t *I, size_t Num) {
+    scanScalar(X, Y, I, Num);
+  }
+#endif
+};
+} // end anonymous namespace
+
+OctantNeighbours OctantIndex::query(Point This) const {
+  OctantNeighbours Res;
+  OctantScanner Scanner(This, Res);
+  long CX = getCol(This.x);
+  long CY = getRow(This.y);
+  long LastCol = Cols - 1;
+  long LastRow = Rows - 1;
+  constexpr Unit Inf = std::numeric_limits<Unit>::max();
+
+  // Buckets [ColB; ColE] of Row are contiguous.
+  auto visit = [&](long ColB, long ColE, long Row) {
+    size_t B = Starts[Row * Cols + ColB];
+    size_t E = Starts[Row * Cols + ColE + 1];
+    Scanner.scan(Xs.data() + B, Ys.data() + B, Idxs.data() + B, E - B);
+  };
+
+  for (long R = 0;; ++R) {
+    long C0 = CX - R, C1 = CX + R;
+    long R0 = CY - R, R1 = CY + R;
+    // Visit buckets of the ring.
+    long ColB = std::max(C0, 0L), ColE = std::min(C1, LastCol);
+    if (R0 >= 0)
+      visit(ColB, ColE, R0);
+    if (R1 <= LastRow && R != 0)
+      visit(ColB, ColE, R1);
+    for (long Row = std::max(R0 + 1, 0L), E = std::min(R1 - 1, LastRow); Row <= E; ++Row) {
+      if (C0 >= 0)
+        visit(C0, C0, Row);
+      if (C1 <= LastCol && R != 0)
+        visit(C1, C1, Row);
+    }
+
+    // Distance to the closest unvisited point on each side.
+    Unit Left = C0 > 0 ? This.x - (LB.x + static_cast<Unit>(C0) * CellW) + 1 : Inf;
+    Unit Right = C1 < LastCol ? LB.x + static_cast<Unit>(C1 + 1) * CellW - This.x : Inf;
+    Unit Down = R0 > 0 ? This.y - (LB.y + static_cast<Unit>(R0) * CellH) + 1 : Inf;
+    Unit Up = R1 < LastRow ? LB.y + static_cast<Unit>(R1 + 1) * CellH - This.y : Inf;
+    if (Left == Inf && Right == Inf && Down == Inf && Up == Inf)
+      break;
+
+    // Unvisited points of the octant lie in its quadrant beyond
+    // visited buckets. Octant is done when they can't be closer
+    // (or as close, because of index tie-break) than the found one.
+    bool Done = true;
+    for (size_t Octant = 0; Octant < 8 && Done; ++Octant) {
+      if (!(UsedOctants & (1u << Octant)))
+        continue;
+      Unit XBound = (Octant & 2) ? Right : Left;
+      Unit YBound = (Octant & 1) ? Up : Down;
+      Unit Bound = std::min(XBound, YBound);
+      Done = Bound == Inf || Res.Dists[Octant] < Bound;
+    }
+    if (Done)
+      break;
+  }
+  return Res;
+}
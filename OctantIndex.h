@@ -0,0 +1,107 @@
+#ifndef STEINER_OCTANT_INDEX_H_DEFINED__
+#define STEINER_OCTANT_INDEX_H_DEFINED__
+
+#include "Net.h"
+#include "Types.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Octant of point To around point This.
+inline size_t getOctant(Point This, Point To) {
+  Unit XDiff = This.x - To.x;
+  Unit YDiff = This.y - To.y;
+  // Encode quadrant.
+  size_t Octant = ((static_cast<size_t>(XDiff < 0) << 1) |
+                   (static_cast<size_t>(YDiff < 0)));
+  // Based on result quadrant, select proper octant.
+  switch (Octant) {
+  case 0:
+  case 2:
+    Octant |= (static_cast<size_t>(XDiff < YDiff) << 2);
+    break;
+  case 1:
+  case 3:
+    Octant |= (static_cast<size_t>(XDiff >= YDiff) << 2);
+    break;
+  default:
+    __builtin_unreachable();
+  }
+  return Octant;
+}
+
+// Points of quadrants 1 and 2 are never split by getOctant,
+// they always get octants 5 and 6.
+constexpr unsigned UsedOctants = 0xF9;
+
+// The closest points in each octant.
+struct OctantNeighbours {
+  static constexpr size_t NoPoint = std::numeric_limits<size_t>::max();
+
+  std::array<size_t, 8> Selected;
+  std::array<Unit, 8> Dists;
+
+  OctantNeighbours() {
+    Selected.fill(NoPoint);
+    Dists.fill(std::numeric_limits<Unit>::max());
+  }
+
+  // Among points with equal distance the one with the least index wins
+  // so result doesn't depend on the order of visiting.
+  void update(size_t Octant, Unit Dist, size_t Idx) {
+    if (Dist < Dists[Octant] ||
+        (Dist == Dists[Octant] && Idx < Selected[Octant])) {
+      Selected[Octant] = Idx;
+      Dists[Octant] = Dist;
+    }
+  }
+  void update(Point This, Point To, size_t Idx) {
+    update(getOctant(This, To), dist(This, To), Idx);
+  }
+};
+
+// Bucket grid over points answering "closest point in each octant"
+// queries. Buckets are visited in rings around the query point until
+// no unvisited point can be closer than the ones already found.
+// Points outside of the bounding box given on construction are
+// clamped to the border buckets.
+//
+// Points are kept as separate x, y and index arrays ordered by bucket
+// (row-major), so buckets of a row are one contiguous range which is
+// scanned with SIMD when AVX2 or AVX-512 is available (build with
+// -DSTEINER_NO_SIMD to force the scalar code). Changes are O(points),
+// queries dominate anyway.
+class OctantIndex {
+  Point LB;
+  Unit CellW = 1, CellH = 1;
+  size_t Cols = 1, Rows = 1;
+  // Points of bucket i are [Starts[i], Starts[i + 1]).
+  std::vector<size_t> Starts = {0, 0};
+  std::vector<Unit> Xs, Ys;
+  std::vector<uint32_t> Idxs;
+
+  size_t getCol(Unit X) const;
+  size_t getRow(Unit Y) const;
+  size_t getCell(Point P) const { return getRow(P.y) * Cols + getCol(P.x); }
+
+public:
+  OctantIndex() = default;
+
+  // Prepare buckets for about ExpectedPts points inside [LB; RU].
+  void reset(Point LB, Point RU, size_t ExpectedPts);
+
+  // Replace all points with Pts[0], ..., Pts[Num - 1] with indices
+  // equal to their positions.
+  void assign(const Point *Pts, size_t Num);
+  void insert(size_t Idx, Point P);
+  void erase(size_t Idx, Point P);
+  // Change index of each point to OldToNew[Idx]. Points mapped
+  // to OctantNeighbours::NoPoint are removed.
+  void renumber(const std::vector<size_t> &OldToNew);
+
+  OctantNeighbours query(Point This) const;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "Parallel.h"
+
+namespace {
+// Pool and queue of the current worker thread.
+thread_local const ThreadPool *CurPool = nullptr;
+thread_local size_t CurQueue = 0;
+} // end anonymous namespace
+
+void ThreadPool::Queue::reserve(size_t Size) {
+  if (Size <= Tasks.size())
+    return;
+  std::vector<Task> New(Size);
+  for (size_t i = 0; i < Num; ++i)
+    New[i] = std::move(Tasks[(Head + i) % Tasks.size()]);
+  Tasks.swap(New);
+  Head = 0;
+}
+
+void ThreadPool::Queue::push_back(Task T) {
+  if (Num == Tasks.size())
+    reserve(std::max<size_t>(16, 2 * Tasks.size()));
+  Tasks[(Head + Num++) % Tasks.size()] = std::move(T);
+}
+
+ThreadPool::Task ThreadPool::Queue::pop_back() {
+  return std::move(Tasks[(Head + --Num) % Tasks.size()]);
+}
+
+ThreadPool::Task ThreadPool::Queue::pop_front() {
+  Task T = std::move(Tasks[Head]);
+  Head = (Head + 1) % Tasks.size();
+  --Num;
+  return T;
+}
+
+ThreadPool::ThreadPool(size_t Threads) {
+  Threads = std::max<size_t>(1, Threads);
+  // Room for all chunks of a parallelFor, so whether they are taken
+  // before the last one is queued doesn't decide when queues grow.
+  for (size_t i = 0; i < Threads; ++i) {
+    Queues.emplace_back(std::make_unique<Queue>());
+    Queues.back()->reserve(Threads * ChunksPerThread);
+  }
+  Workers.reserve(Threads - 1);
+  for (size_t i = 0; i + 1 < Threads; ++i)
+    Workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> Lock(SleepM);
+    Stop = true;
+  }
+  SleepCV.notify_all();
+  for (auto &W : Workers)
+    W.join();
+}
+
+size_t ThreadPool::getSelf() const {
+  return CurPool == this ? CurQueue : Queues.size() - 1;
+}
+
+bool ThreadPool::tryRun(size_t Self) {
+  Task T;
+  bool Found = false;
+  // Own tasks are taken in LIFO order, they are likely hot in cache.
+  {
+    Queue &Q = *Queues[Self];
+    std::lock_guard<std::mutex> Lock(Q.M);
+    if (!Q.empty()) {
+      T = Q.pop_back();
+      Found = true;
+    }
+  }
+  // Steal the oldest task of somebody else.
+  for (size_t i = 1, e = Queues.size(); i < e && !Found; ++i) {
+    Queue &Q = *Queues[(Self + i) % e];
+    std::lock_guard<std::mutex> Lock(Q.M);
+    if (!Q.empty()) {
+      T = Q.pop_front();
+      Found = true;
+    }
+  }
+  if (!Found)
+    return false;
+
+  Queued.fetch_sub(1, std::memory_order_relaxed);
+  T.F();
+  if (T.Group->Pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // Wake up threads waiting for the group.
+    std::lock_guard<std::mutex> Lock(SleepM);
+    SleepCV.notify_all();
+  }
+  return true;
+}
+
+void ThreadPool::workerLoop(size_t Self) {
+  CurPool = this;
+  CurQueue = Self;
+  for (;;) {
+    if (tryRun(Self))
+      continue;
+    std::unique_lock<std::mutex> Lock(SleepM);
+    SleepCV.wait(Lock, [this]() { return Stop || Queued.load() != 0; });
+    if (Stop)
+      return;
+  }
+}
+
+void ThreadPool::submit(TaskGroup &Group, std::function<void()> F) {
+  Group.Pending.fetch_add(1, std::memory_order_relaxed);
+  // Count the task before it can be taken, so tryRun() never moves
+  // Queued below zero.
+  {
+    std::lock_guard<std::mutex> Lock(SleepM);
+    Queued.fetch_add(1, std::memory_order_relaxed);
+  }
+  Queue &Q = *Queues[getSelf()];
+  {
+    std::lock_guard<std::mutex> Lock(Q.M);
+    Q.push_back({std::move(F), &Group});
+  }
+  SleepCV.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup &Group) {
+  size_t Self = getSelf();
+  while (Group.Pending.load(std::memory_order_acquire) != 0) {
+    if (tryRun(Self))
+      continue;
+    std::unique_lock<std::mutex> Lock(SleepM);
+    SleepCV.wait(Lock, [&]() {
+        return Queued.load() != 0 || Group.Pending.load() == 0;
+      });
+  }
+}
@@ -0,0 +1,115 @@
+#ifndef STEINER_PARALLEL_H_DEFINED__
+#define STEINER_PARALLEL_H_DEFINED__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Resolve user-provided number of threads. Zero means "all cores".
+inline size_t getThreadsNum(size_t Requested) {
+  if (Requested != 0)
+    return Requested;
+  size_t HW = std::thread::hardware_concurrency();
+  return HW == 0 ? 1 : HW;
+}
+
+// Set of tasks which can be waited for together.
+class TaskGroup {
+  friend class ThreadPool;
+  std::atomic<size_t> Pending{0};
+};
+
+// Work-stealing thread pool. Each worker has its own deque: it takes
+// tasks from the back of it and steals from the front of others when
+// it runs out of work. Tasks may submit and wait for other tasks;
+// waiting thread executes pending tasks meanwhile, so nested
+// parallelism doesn't deadlock.
+class ThreadPool {
+  struct Task {
+    std::function<void()> F;
+    TaskGroup *Group;
+  };
+  // Ring buffer of tasks. Unlike std::deque it keeps its memory, so
+  // parallelFor doesn't allocate once the queues are large enough.
+  class Queue {
+    std::vector<Task> Tasks;
+    size_t Head = 0;
+    size_t Num = 0;
+
+  public:
+    std::mutex M;
+
+    bool empty() const { return Num == 0; }
+    void reserve(size_t Size);
+    void push_back(Task T);
+    Task pop_back();
+    Task pop_front();
+  };
+
+  // One queue per worker and the last one for external threads.
+  std::vector<std::unique_ptr<Queue>> Queues;
+  std::vector<std::thread> Workers;
+
+  std::mutex SleepM;
+  std::condition_variable SleepCV;
+  std::atomic<size_t> Queued{0};
+  bool Stop = false;
+
+  size_t getSelf() const;
+  bool tryRun(size_t Self);
+  void workerLoop(size_t Self);
+
+public:
+  // Total number of threads including the one calling wait().
+  explicit ThreadPool(size_t Threads);
+
+  ThreadPool(const ThreadPool &) = delete;
+  void operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  size_t size() const { return Workers.size() + 1; }
+
+  void submit(TaskGroup &Group, std::function<void()> F);
+  // Returns when all tasks of Group are done.
+  void wait(TaskGroup &Group);
+};
+
+// Several chunks per thread to smooth out uneven work.
+constexpr size_t ChunksPerThread = 8;
+
+// Number of chunks parallelFor splits Size items into.
+inline size_t getChunksNum(const ThreadPool *Pool, size_t Size) {
+  if (!Pool || Pool->size() == 1)
+    return std::min<size_t>(Size, 1);
+  return std::min(Size, Pool->size() * ChunksPerThread);
+}
+
+// Split [0, Size) into getChunksNum(Pool, Size) chunks and process them
+// with Pool (or in the calling thread if Pool is null). Body is called
+// as Body(ChunkIdx, Begin, End) so callers can keep per-chunk state
+// without synchronization and combine it in a fixed order.
+template<typename Body>
+void parallelFor(ThreadPool *Pool, size_t Size, Body F) {
+  size_t Chunks = getChunksNum(Pool, Size);
+  if (Chunks <= 1) {
+    if (Chunks == 1)
+      F(size_t(0), size_t(0), Size);
+    return;
+  }
+
+  auto Run = [&F, Size, Chunks](size_t Chunk) {
+    F(Chunk, Size * Chunk / Chunks, Size * (Chunk + 1) / Chunks);
+  };
+  TaskGroup Group;
+  for (size_t Chunk = 1; Chunk < Chunks; ++Chunk)
+    Pool->submit(Group, [&Run, Chunk]() { Run(Chunk); });
+  Run(0);
+  Pool->wait(Group);
+}
+
+#endif
@@ -0,0 +1,14 @@
+#include "RankSpace.h"
+
+RankSpace::RankSpace(const Net &N) {
+  Xs.reserve(N.size());
+  Ys.reserve(N.size());
+  for (auto Pt : N) {
+    Xs.emplace_back(Pt.x);
+    Ys.emplace_back(Pt.y);
+  }
+  std::sort(Xs.begin(), Xs.end());
+  std::sort(Ys.begin(), Ys.end());
+  Xs.erase(std::unique(Xs.begin(), Xs.end()), Xs.end());
+  Ys.erase(std::unique(Ys.begin(), Ys.end()), Ys.end());
+}
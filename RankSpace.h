@@ -0,0 +1,56 @@
+#ifndef STEINER_RANK_SPACE_H_DEFINED__
+#define STEINER_RANK_SPACE_H_DEFINED__
+
+#include "Net.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Ranks of coordinates of a point in a RankSpace.
+template<typename T>
+struct RankPoint {
+  T X, Y;
+};
+
+// Sorted unique coordinates of pins of a net. Pins and all Hanan grid
+// points lie on these tracks, so they can be kept as pairs of ranks,
+// 16 bit ones if there are at most 65536 tracks in each direction.
+// Coordinates are looked up in the tables, distances between ranks
+// are differences of them.
+class RankSpace {
+  std::vector<Unit> Xs, Ys;
+
+public:
+  RankSpace() = default;
+  explicit RankSpace(const Net &N);
+
+  const std::vector<Unit> &getXs() const { return Xs; }
+  const std::vector<Unit> &getYs() const { return Ys; }
+
+  // Coordinates should be on the tracks.
+  size_t getXRank(Unit X) const {
+    auto It = std::lower_bound(Xs.begin(), Xs.end(), X);
+    assert(It != Xs.end() && *It == X && "Not on a track");
+    return It - Xs.begin();
+  }
+  size_t getYRank(Unit Y) const {
+    auto It = std::lower_bound(Ys.begin(), Ys.end(), Y);
+    assert(It != Ys.end() && *It == Y && "Not on a track");
+    return It - Ys.begin();
+  }
+
+  // Ranks fit uint16_t.
+  bool isNarrow() const {
+    constexpr size_t Max = size_t(std::numeric_limits<uint16_t>::max()) + 1;
+    return Xs.size() <= Max && Ys.size() <= Max;
+  }
+
+  template<typename T>
+  Point getPoint(RankPoint<T> R) const { return Point(Xs[R.X], Ys[R.Y]); }
+};
+
+#endif
@@ -0,0 +1,944 @@
+#include "Router.h"
+#include "ExactSteiner.h"
+#include "LookupTable.h"
+#include "OctantIndex.h"
+#include "StlHelpers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+[[maybe_unused]]
+void dumpPoints(const std::vector<Point> &Pts) {
+  for (Point P : Pts) {
+    std::cout << P << std::endl;
+  }
+}
+
+using EdgeTy = typename Graph<Point>::EdgeType;
+
+// Connect new point with at most 8 others: the closest point
+// in each octant. New point gets index PNum.
+void connectNewPoint(std::vector<EdgeTy> &Edges, Point This, size_t PNum,
+                     const OctantIndex &Index) {
+  OctantNeighbours Nbrs = Index.query(This);
+  for (size_t i = 0; i < Nbrs.Selected.size(); ++i) {
+    if (Nbrs.Selected[i] != OctantNeighbours::NoPoint)
+      Edges.emplace_back(Nbrs.Selected[i], PNum, Nbrs.Dists[i]);
+  }
+}
+
+// Three points forming a corner of the MST of pins: a vertex and two of
+// its neighbours. A Steiner point shortens the tree only if it replaces
+// edges of such corners, the best one for a corner is at the median.
+static void forEachMSTCorner(const Net &N,
+                             std::function<void(Point, Point, Point)> F) {
+  Graph<Point> G(N.begin(), N.end());
+  connectSpanningGraph(G);
+  std::vector<EdgeTy> Tmp;
+  sortEdgesByWeight(G, Tmp);
+  std::vector<std::vector<size_t>> Nbrs(G.vertices_size());
+  for (EdgeTy E : getMSTEdges(G)) {
+    Nbrs[E.From].push_back(E.To);
+    Nbrs[E.To].push_back(E.From);
+  }
+  for (size_t V = 0, VE = Nbrs.size(); V < VE; ++V) {
+    for (size_t i = 0, e = Nbrs[V].size(); i < e; ++i) {
+      for (size_t j = i + 1; j < e; ++j)
+        F(G.vertice(V), G.vertice(Nbrs[V][i]), G.vertice(Nbrs[V][j]));
+    }
+  }
+}
+
+static Unit median(Unit A, Unit B, Unit C) {
+  return std::max(std::min(A, B), std::min(std::max(A, B), C));
+}
+
+CandidateSet getCandidates(const Net &N, unsigned Pruning) {
+  if (Pruning == 0)
+    return CandidateSet::getHananGrid(N);
+
+  CandidateSet Res{RankSpace(N)};
+  const RankSpace &Tracks = Res.getTracks();
+  const std::vector<Unit> &Xs = Tracks.getXs(), &Ys = Tracks.getYs();
+  std::vector<Point> Pins(N.begin(), N.end());
+  std::sort(Pins.begin(), Pins.end());
+  auto add = [&](size_t X, size_t Y) {
+    if (!std::binary_search(Pins.begin(), Pins.end(), Point(Xs[X], Ys[Y])))
+      Res.add(X, Y);
+  };
+
+  if (Pruning >= 2) {
+    std::vector<Point> Medians;
+    forEachMSTCorner(N, [&](Point A, Point B, Point C) {
+        Medians.emplace_back(median(A.x, B.x, C.x), median(A.y, B.y, C.y));
+      });
+    std::sort(Medians.begin(), Medians.end());
+    Medians.erase(std::unique(Medians.begin(), Medians.end()), Medians.end());
+    for (Point P : Medians)
+      add(Tracks.getXRank(P.x), Tracks.getYRank(P.y));
+    return Res;
+  }
+
+  // Ranges of y ranks covered by bounding boxes of corners
+  // in each column of the grid.
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> Columns(Xs.size());
+  forEachMSTCorner(N, [&](Point A, Point B, Point C) {
+      size_t XB = Tracks.getXRank(std::min({A.x, B.x, C.x}));
+      size_t XE = Tracks.getXRank(std::max({A.x, B.x, C.x}));
+      uint32_t YB = Tracks.getYRank(std::min({A.y, B.y, C.y}));
+      uint32_t YE = Tracks.getYRank(std::max({A.y, B.y, C.y}));
+      for (size_t X = XB; X <= XE; ++X)
+        Columns[X].emplace_back(YB, YE);
+    });
+  for (size_t X = 0, XEnd = Xs.size(); X < XEnd; ++X) {
+    auto &Ranges = Columns[X];
+    std::sort(Ranges.begin(), Ranges.end());
+    size_t Next = 0;
+    for (auto [YB, YE] : Ranges) {
+      for (size_t Y = std::max<size_t>(YB, Next); Y <= YE; ++Y)
+        add(X, Y);
+      Next = std::max<size_t>(Next, YE + 1);
+    }
+    std::vector<std::pair<uint32_t, uint32_t>>().swap(Ranges);
+  }
+  return Res;
+}
+
+// Size of the Hanan grid of N without pins.
+static size_t getHanansGridSize(const Net &N) {
+  RankSpace Tracks(N);
+  std::vector<Point> Pins(N.begin(), N.end());
+  std::sort(Pins.begin(), Pins.end());
+  size_t PNum = std::unique(Pins.begin(), Pins.end()) - Pins.begin();
+  return Tracks.getXs().size() * Tracks.getYs().size() - PNum;
+}
+
+Deadline::Deadline(double BudgetMs) {
+  if (BudgetMs <= 0)
+    return;
+  End = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double, std::milli>(
+          std::min(BudgetMs, MaxTimeBudgetMs)));
+}
+
+Unit getEdgesWeight(const Graph<Point> &G) {
+  return std::accumulate(G.edges_begin(), G.edges_end(), Unit(),
+                         [](Unit TotalLen, EdgeTy Edge) {
+                           return TotalLen + Edge.Weight;
+                         });
+}
+
+// Add edges of new point PNum to sorted edges of G. NewEdges gets the
+// new edges, Merged is used as a buffer and gets old edges of G.
+void prepareNewGraphEdges(Graph<Point> &G, std::vector<EdgeTy> &NewEdges,
+                          std::vector<EdgeTy> &Merged, size_t PNum,
+                          const OctantIndex &Index) {
+  NewEdges.clear();
+  connectNewPoint(NewEdges, G.vertice(PNum), PNum, Index);
+  // All old edges are already sorted so there is no need to sort all range.
+  // Just sort new edges and then merge. Unlike inplace_merge merging
+  // into a buffer we own doesn't allocate.
+  sortEdgesByWeight(NewEdges, Merged);
+  Merged.clear();
+  std::merge(G.edges_begin(), G.edges_end(), NewEdges.begin(), NewEdges.end(),
+             std::back_inserter(Merged), [](EdgeTy A, EdgeTy B) {
+               return A.key() < B.key();
+             });
+  G.swapEdges(Merged);
+}
+
+// Get MST length of the tree with Pt added. The tree has length TreeLen,
+// T and Index should be built for it. Nothing is modified.
+Unit evalCandidate(const OctantIndex &Index, const PathMaxTree &T,
+                   Unit TreeLen, Point Pt) {
+  OctantNeighbours Nbrs = Index.query(Pt);
+  std::array<size_t, 8> Selected;
+  std::array<Unit, 8> Dists;
+  size_t Num = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    if (Nbrs.Selected[i] == OctantNeighbours::NoPoint)
+      continue;
+    Selected[Num] = Nbrs.Selected[i];
+    Dists[Num] = Nbrs.Dists[i];
+    ++Num;
+  }
+  return getExtendedMSTLen(T, TreeLen, Selected.data(), Dists.data(), Num);
+}
+
+// The best candidate of a round. Candidates with equal length are
+// ordered by index (the greatest wins) so the result doesn't depend
+// on the order in which candidates were evaluated.
+struct BestCandidate {
+  Unit Len = std::numeric_limits<Unit>::max();
+  size_t Idx = 0;
+  bool Found = false;
+
+  void update(Unit NewLen, size_t NewIdx) {
+    if (!Found || NewLen < Len || (NewLen == Len && NewIdx > Idx)) {
+      Len = NewLen;
+      Idx = NewIdx;
+      Found = true;
+    }
+  }
+
+  void update(const BestCandidate &O) {
+    if (O.Found)
+      update(O.Len, O.Idx);
+  }
+};
+
+// Candidates are evaluated in steps of this size between checks of the
+// deadline, so the clock costs little compared with evaluations.
+constexpr size_t DeadlineStep = 256;
+
+// Call F(Idx, Pt) for candidates of Grid in [Begin, End) while Until
+// hasn't passed. Returns false if some of them were skipped.
+template<typename Fn>
+static bool forEachUntil(const CandidateSet &Grid, size_t Begin, size_t End,
+                         const Deadline &Until, Fn F) {
+  for (size_t Step = Begin; Step < End; Step += DeadlineStep) {
+    if (Until.passed())
+      return false;
+    Grid.forEach(Step, std::min(End, Step + DeadlineStep), F);
+  }
+  return true;
+}
+
+// Evaluate all candidates of Grid against G and put the best one into
+// Res. Best is a buffer for results of chunks. Returns false and leaves
+// Res as is if Until passes first.
+bool findBestCandidate(const OctantIndex &Index, const PathMaxTree &T,
+                       Unit TreeLen, const CandidateSet &Grid,
+                       ThreadPool *Pool, const Deadline &Until,
+                       std::vector<BestCandidate> &Best, BestCandidate &Res) {
+  assign_geometric(Best, getChunksNum(Pool, Grid.size()), BestCandidate());
+  std::atomic<bool> Expired{false};
+  parallelFor(Pool, Grid.size(), [&](size_t Chunk, size_t Begin, size_t End) {
+      auto &ChunkBest = Best[Chunk];
+      if (!forEachUntil(Grid, Begin, End, Until, [&](size_t i, Point Pt) {
+            ChunkBest.update(evalCandidate(Index, T, TreeLen, Pt), i);
+          }))
+        Expired.store(true, std::memory_order_relaxed);
+    });
+  if (Expired.load(std::memory_order_relaxed))
+    return false;
+
+  for (const auto &B : Best)
+    Res.update(B);
+  return true;
+}
+
+// Evaluate all candidates of Grid against G. Lens[i] gets MST length
+// of G with Grid[i] added, TreeLen for removed candidates. Returns false
+// if Until passes first, then only some of Lens are filled.
+bool evalCandidates(const OctantIndex &Index, const PathMaxTree &T,
+                    Unit TreeLen, const CandidateSet &Grid,
+                    ThreadPool *Pool, const Deadline &Until,
+                    std::vector<Unit> &Lens) {
+  Lens.assign(Grid.size(), TreeLen);
+  std::atomic<bool> Expired{false};
+  parallelFor(Pool, Grid.size(), [&](size_t, size_t Begin, size_t End) {
+      if (!forEachUntil(Grid, Begin, End, Until, [&](size_t i, Point Pt) {
+            Lens[i] = evalCandidate(Index, T, TreeLen, Pt);
+          }))
+        Expired.store(true, std::memory_order_relaxed);
+    });
+  return !Expired.load(std::memory_order_relaxed);
+}
+
+using VertEdges = std::pair<EdgeTy *, EdgeTy *>;
+
+// Candidate of lazy rounds with the gain it had against the tree
+// of version Version.
+struct LazyCandidate {
+  Unit Gain;
+  size_t Idx;
+  size_t Version;
+
+  bool operator<(const LazyCandidate &O) const {
+    return Gain != O.Gain ? Gain < O.Gain : Idx < O.Idx;
+  }
+};
+
+// Memory reused by all rounds of one iteratedSteiner run. Buffers keep
+// their capacity, so rounds don't allocate once the tree stops growing.
+struct SteinerScratch {
+  UnionFind UF;
+  std::vector<EdgeTy> TmpEdges, NewEdges;
+  // Results of chunks in findBestCandidate.
+  std::vector<BestCandidate> Best;
+  // Batched rounds.
+  std::vector<Unit> Lens;
+  std::vector<std::pair<Unit, size_t>> Gains;
+  std::vector<size_t> Added;
+  // Lazy rounds.
+  std::vector<LazyCandidate> Heap;
+  // remove2DegreePoints.
+  std::vector<int> Degrees;
+  std::vector<VertEdges> EdgesToConnect;
+  std::vector<bool> Keep;
+  std::vector<size_t> OldToNew;
+  Graph<Point>::DedupeScratch Dedupe;
+
+  // Make sure rounds with trees of up to VNum vertices don't allocate.
+  void reserve(size_t VNum) {
+    UF.reserve(VNum);
+    // MST edges and edges of the new point.
+    TmpEdges.reserve(VNum + 8);
+    NewEdges.reserve(8);
+    Degrees.reserve(VNum);
+    EdgesToConnect.reserve(VNum);
+    Keep.reserve(VNum);
+    OldToNew.reserve(VNum);
+    Dedupe.Offsets.reserve(VNum + 1);
+    Dedupe.Order.reserve(VNum);
+    Dedupe.Seen.reserve(VNum);
+  }
+};
+
+static void
+rememberEdge(EdgeTy *Edge, std::vector<VertEdges> &EdgesToConnect,
+             int Degree, size_t VertIdx) {
+  if (Degree == 1)
+    EdgesToConnect[VertIdx].first = Edge;
+  else if (Degree == 2)
+    EdgesToConnect[VertIdx].second = Edge;
+  else {
+    EdgesToConnect[VertIdx].first = nullptr;
+    EdgesToConnect[VertIdx].second = nullptr;
+  }
+}
+
+// Returns new index of each vertex or OctantNeighbours::NoPoint
+// if it was removed. The result is stored in S.
+static_assert(Graph<Point>::NoVertex == OctantNeighbours::NoPoint,
+              "Remap of the graph is passed to OctantIndex");
+const std::vector<size_t> &
+remove2DegreePoints(Graph<Point> &G, size_t NetPts, SteinerScratch &S) {
+  std::vector<int> &Degrees = S.Degrees;
+  std::vector<VertEdges> &EdgesToConnect = S.EdgesToConnect;
+  assign_geometric(Degrees, G.vertices_size() - NetPts, 0);
+  assign_geometric(EdgesToConnect, Degrees.size(), VertEdges());
+
+  // Find all added vertices with degree <= 2.
+  for (auto &Edge : G.edges()) {
+    if (Edge.From >= NetPts) {
+      int DFrom = ++Degrees[Edge.From - NetPts];
+      rememberEdge(&Edge, EdgesToConnect, DFrom, Edge.From - NetPts);
+    }
+    if (Edge.To >= NetPts) {
+      int DTo = ++Degrees[Edge.To - NetPts];
+      rememberEdge(&Edge, EdgesToConnect, DTo, Edge.To - NetPts);
+    }
+  }
+
+  // Join edges of points with degree two. Edges of removed points with
+  // degree one are dropped by compaction together with the point, as
+  // are stale copies of joined edges still pointing at removed points.
+  for (size_t VertIdx = 0, VE = Degrees.size(); VertIdx < VE; ++VertIdx) {
+    if (Degrees[VertIdx] == 2) {
+      auto &Edge1 = *EdgesToConnect[VertIdx].first;
+      auto &Edge2 = *EdgesToConnect[VertIdx].second;
+      size_t Vert = VertIdx + NetPts;
+      // x -> a
+      if (Edge1.From == Vert) {
+        // x -> b
+        if (Edge2.From == Vert)
+          // b -> a
+          Edge1.From = Edge2.To;
+        // b -> x
+        else
+          // b -> a
+          Edge1.From = Edge2.From;
+      // a -> x
+      } else {
+        // x -> b
+        if (Edge2.From == Vert)
+          // a -> b
+          Edge1.To = Edge2.To;
+        // b -> x
+        else
+          // a -> b
+          Edge1.To = Edge2.From;
+      }
+      Edge1.Weight = dist(G.vertice(Edge1.From), G.vertice(Edge1.To));
+      // Save all info since next iterations could use this info.
+      Edge2 = Edge1;
+    }
+  }
+
+  std::vector<bool> &Keep = S.Keep;
+  reserve_geometric(Keep, G.vertices_size());
+  Keep.assign(NetPts, true);
+  for (int D : Degrees)
+    Keep.push_back(D > 2);
+  G.compact(Keep, S.OldToNew);
+  // Joined edges are left in both of their slots.
+  G.dedupeEdges(S.Dedupe);
+  return S.OldToNew;
+}
+
+Graph<Point> iteratedSteiner(const Net &N, CandidateSet Grid,
+                             const SteinerOptions &Opts,
+                             SteinerStats *Stats) {
+  if (!StatsEnabled)
+    Stats = nullptr;
+  // Stopped when the initial tree is built.
+  std::optional<StatsTimer> InitTimer(std::in_place,
+                                      getStat(Stats, &SteinerStats::InitialMSTMs));
+  if (Stats) {
+    Stats->Pins = N.size();
+    Stats->Candidates = Grid.alive();
+  }
+
+  // The tree is valid after each addition, so rounds can stop anytime.
+  Deadline Until = Opts.NetDeadline.isSet() ? Opts.NetDeadline :
+    Deadline(Opts.TimeBudgetMs);
+  auto OutOfTime = [&]() { return Until.passed(); };
+  StopReason Stop = StopReason::Converged;
+  size_t Rounds = 0;
+  bool Lazy = Opts.Lazy && !Opts.Batched;
+
+  bool Changed = true;
+  Graph<Point> G(N.begin(), N.end());
+  connectSpanningGraph(G);
+
+  // Steiner points of degree 2 or less are removed after each addition,
+  // so there are less than N.size() of them, plus one just added.
+  // Memory for such trees is reserved once.
+  size_t MaxVNum = 2 * N.size();
+  SteinerScratch S;
+  S.reserve(MaxVNum);
+  S.Best.reserve(getChunksNum(Opts.Pool, Grid.size()));
+  G.vertices_reserve(MaxVNum);
+  G.edges_reserve(MaxVNum + 8);
+
+  // Path maximums of the current tree, rebuilt after each change.
+  PathMaxTree T;
+  T.reserve(MaxVNum);
+
+  // All vertices and candidates are inside bounding box of the net.
+  OctantIndex Index;
+  if (N.size() != 0) {
+    auto [XMin, XMax] = std::minmax_element(N.begin(), N.end(), [](Point A, Point B) {
+        return A.x < B.x;
+      });
+    auto [YMin, YMax] = std::minmax_element(N.begin(), N.end(), [](Point A, Point B) {
+        return A.y < B.y;
+      });
+    Index.reset(Point(XMin->x, YMin->y), Point(XMax->x, YMax->y), 2 * N.size());
+    Index.assign(&G.vertice(0), G.vertices_size());
+  }
+
+  // Initial length.
+  // TODO: remove this after special graph methods will be added.
+  sortEdgesByWeight(G, S.TmpEdges);
+  if (Stats) {
+    Stats->EdgesSorted += G.edges_size();
+    ++Stats->MSTBuilds;
+  }
+  getMSTEdges(G, S.UF, S.TmpEdges);
+  G.swapEdges(S.TmpEdges);
+  Unit MinLen = getEdgesWeight(G);
+  InitTimer.reset();
+
+  // Add new point to the tree. Edges stay sorted since
+  // MST edges are produced in order of their weights.
+  auto AddPoint = [&](Point Pt) {
+    size_t OldPNum = G.vertices_size();
+    G.push_vertice(Pt);
+    prepareNewGraphEdges(G, S.NewEdges, S.TmpEdges, OldPNum, Index);
+    if (Stats) {
+      Stats->EdgesSorted += S.NewEdges.size();
+      ++Stats->MSTBuilds;
+    }
+    getMSTEdges(G, S.UF, S.TmpEdges);
+    G.swapEdges(S.TmpEdges);
+    Index.insert(OldPNum, Pt);
+  };
+
+  auto RemovePoints = [&]() {
+    StatsTimer RemoveTimer(getStat(Stats, &SteinerStats::RemovePointsMs));
+    const std::vector<size_t> &OldToNew = remove2DegreePoints(G, N.size(), S);
+    sortEdgesByWeight(G, S.TmpEdges);
+    if (Stats) {
+      Stats->RemovedPoints += std::count(OldToNew.begin(), OldToNew.end(),
+                                         OctantNeighbours::NoPoint);
+      Stats->EdgesSorted += G.edges_size();
+    }
+    Index.renumber(OldToNew);
+  };
+
+  std::vector<Unit> &Lens = S.Lens;
+  std::vector<std::pair<Unit, size_t>> &Gains = S.Gains;
+  std::vector<size_t> &Added = S.Added;
+  std::vector<LazyCandidate> &Heap = S.Heap;
+  // Changes of the tree in lazy rounds.
+  size_t Version = 0;
+
+  while (Changed && !Grid.empty()) {
+    if (Opts.MaxRounds && Rounds == Opts.MaxRounds) {
+      Stop = StopReason::MaxRounds;
+      break;
+    }
+    if (OutOfTime()) {
+      Stop = StopReason::TimeBudget;
+      break;
+    }
+    ++Rounds;
+    Changed = false;
+    if (Stats) {
+      ++Stats->Rounds;
+      // Lazy rounds count their evaluations themselves.
+      size_t Evaluated = Lazy ? 0 : Grid.alive();
+      Stats->RoundCandidates.push_back(Evaluated);
+      Stats->CandidateEvaluations += Evaluated;
+      Stats->RoundMs.push_back(0);
+    }
+    StatsTimer RoundTimer(Stats ? &Stats->RoundMs.back() : nullptr);
+    size_t AllocsBefore = Stats && getAllocationsNum ? getAllocationsNum() : 0;
+
+    Unit TreeLen = getEdgesWeight(G);
+    T.build(G);
+
+    if (Lazy) {
+      // Candidates are kept in a max-heap by their last known gain,
+      // which usually only decreases as the tree grows. The top one is
+      // re-evaluated until it is still on top with the fresh gain.
+      // Ones without enough gain are dropped until the heap runs out,
+      // then all candidates are evaluated again. Points without gain
+      // aren't added, see SteinerOptions::Lazy.
+      Unit MinGain = std::max(Opts.MinGain, Unit(1));
+      auto CountEvaluations = [&](size_t Num) {
+        if (Stats) {
+          Stats->RoundCandidates.back() += Num;
+          Stats->CandidateEvaluations += Num;
+        }
+      };
+      auto Refill = [&]() {
+        Heap.clear();
+        if (!evalCandidates(Index, T, TreeLen, Grid, Opts.Pool, Until, Lens)) {
+          Stop = StopReason::TimeBudget;
+          return;
+        }
+        CountEvaluations(Grid.alive());
+        bool Improves = false;
+        for (size_t i = 0, e = Grid.size(); i < e; ++i) {
+          Improves |= Lens[i] < TreeLen;
+          if (TreeLen - Lens[i] >= MinGain)
+            Heap.push_back({TreeLen - Lens[i], i, Version});
+        }
+        std::make_heap(Heap.begin(), Heap.end());
+        if (Heap.empty() && Improves)
+          Stop = StopReason::MinGain;
+      };
+
+      bool Refilled = false;
+      std::optional<size_t> Pick;
+      while (!Pick) {
+        if (Heap.empty()) {
+          if (Refilled)
+            break;
+          Refill();
+          Refilled = true;
+          continue;
+        }
+        std::pop_heap(Heap.begin(), Heap.end());
+        LazyCandidate Top = Heap.back();
+        Heap.pop_back();
+        if (Top.Version == Version) {
+          Pick = Top.Idx;
+          break;
+        }
+        if (OutOfTime()) {
+          Stop = StopReason::TimeBudget;
+          break;
+        }
+        CountEvaluations(1);
+        Unit Gain = TreeLen - evalCandidate(Index, T, TreeLen, Grid[Top.Idx]);
+        if (Gain < MinGain)
+          continue;
+        Heap.push_back({Gain, Top.Idx, Version});
+        std::push_heap(Heap.begin(), Heap.end());
+      }
+
+      if (Pick) {
+        Changed = true;
+        AddPoint(Grid[*Pick]);
+        RemovePoints();
+        Grid.remove(*Pick);
+        ++Version;
+      }
+    } else if (!Opts.Batched) {
+      BestCandidate Best;
+      if (!findBestCandidate(Index, T, TreeLen, Grid, Opts.Pool, Until, S.Best,
+                             Best))
+        Stop = StopReason::TimeBudget;
+      size_t BestCandidateIdx = Best.Idx;
+      // Save point if it is the best solution.
+      if (Best.Found && Best.Len <= MinLen) {
+        if (Opts.MinGain && TreeLen - Best.Len < Opts.MinGain) {
+          Stop = StopReason::MinGain;
+        } else {
+          Changed = true;
+          MinLen = Best.Len;
+        }
+      }
+
+      // Add new point.
+      if (Changed) {
+        AddPoint(Grid[BestCandidateIdx]);
+        RemovePoints();
+
+        // Remove selected point from list of candidates.
+        Grid.remove(BestCandidateIdx);
+      }
+    } else {
+      // Batched round: rank candidates by gain and add all of them
+      // that keep their gain after previous additions of this round.
+      Gains.clear();
+      Unit MinGain = std::max(Opts.MinGain, Unit(1));
+      bool Improves = false;
+      if (!evalCandidates(Index, T, TreeLen, Grid, Opts.Pool, Until, Lens)) {
+        Stop = StopReason::TimeBudget;
+      } else {
+        for (size_t i = 0, e = Grid.size(); i < e; ++i) {
+          Improves |= Lens[i] < TreeLen;
+          if (TreeLen - Lens[i] >= MinGain)
+            Gains.emplace_back(TreeLen - Lens[i], i);
+        }
+      }
+      if (Gains.empty() && Improves)
+        Stop = StopReason::MinGain;
+      // Greater gain first, ties are resolved as in one-per-round mode.
+      std::sort(Gains.begin(), Gains.end(), [](const auto &A, const auto &B) {
+          return A.first != B.first ? A.first > B.first : A.second > B.second;
+        });
+
+      Added.clear();
+      for (auto [Gain, Idx] : Gains) {
+        // The first one is evaluated against the current tree already.
+        if (!Added.empty()) {
+          if (OutOfTime()) {
+            Stop = StopReason::TimeBudget;
+            break;
+          }
+          if (Stats)
+            ++Stats->CandidateEvaluations;
+          if (TreeLen - evalCandidate(Index, T, TreeLen, Grid[Idx]) < Gain)
+            continue;
+        }
+        AddPoint(Grid[Idx]);
+        Added.push_back(Idx);
+        TreeLen = getEdgesWeight(G);
+        T.build(G);
+      }
+
+      if (!Added.empty()) {
+        Changed = true;
+        RemovePoints();
+
+        // Remove selected points from list of candidates.
+        for (size_t Idx : Added)
+          Grid.remove(Idx);
+      }
+    }
+
+    if (Stats && getAllocationsNum)
+      Stats->RoundAllocations.push_back(getAllocationsNum() - AllocsBefore);
+  }
+
+  if (Stats)
+    Stats->Stop = Stop;
+  if (Stats)
+    Stats->RoundsMs = std::accumulate(Stats->RoundMs.begin(),
+                                      Stats->RoundMs.end(), 0.0);
+
+  return G;
+}
+
+void fillNet(Net &N, const Graph<Point> &G) {
+  for (auto Edge : G.edges()) {
+    N.addConnection(G.vertice(Edge.From), G.vertice(Edge.To));
+  }
+}
+
+// Tree for the net from the solver Opts select for its size.
+static Graph<Point> buildTree(const Net &N, const SteinerOptions &Opts,
+                              SteinerStats *Stats) {
+  if (N.size() <= Opts.ExactDegree) {
+    if (Stats) {
+      Stats->Pins = N.size();
+      Stats->Exact = true;
+    }
+    return exactSteiner(N, Opts.Pool);
+  }
+  if (Opts.LUT && N.size() <= Opts.LUT->getMaxDegree()) {
+    if (Stats) {
+      Stats->Pins = N.size();
+      Stats->LookupTable = true;
+    }
+    return Opts.LUT->route(N);
+  }
+  CandidateSet C;
+  {
+    StatsTimer T(getStat(Stats, &SteinerStats::HananGridMs));
+    C = getCandidates(N, Opts.Pruning);
+  }
+  if (Stats)
+    Stats->HananPoints = Opts.Pruning ? getHanansGridSize(N) : C.alive();
+  return iteratedSteiner(N, std::move(C), Opts, Stats);
+}
+
+// Split Order[Begin, End) at the median of the longer side of its
+// bounding box until parts have at most Size pins. Ends of parts
+// are appended to Ends.
+static void splitPins(const std::vector<Point> &Pts, std::vector<size_t> &Order,
+                      size_t Begin, size_t End, size_t Size,
+                      std::vector<size_t> &Ends) {
+  if (End - Begin <= Size) {
+    Ends.push_back(End);
+    return;
+  }
+  Point Min = Pts[Order[Begin]], Max = Min;
+  for (size_t i = Begin + 1; i < End; ++i) {
+    Point P = Pts[Order[i]];
+    Min = Point(std::min(Min.x, P.x), std::min(Min.y, P.y));
+    Max = Point(std::max(Max.x, P.x), std::max(Max.y, P.y));
+  }
+  Unit Point::*Axis = Max.x - Min.x >= Max.y - Min.y ? &Point::x : &Point::y;
+  size_t Mid = Begin + (End - Begin) / 2;
+  std::nth_element(Order.begin() + Begin, Order.begin() + Mid,
+                   Order.begin() + End, [&](size_t A, size_t B) {
+                     return Pts[A].*Axis < Pts[B].*Axis;
+                   });
+  splitPins(Pts, Order, Begin, Mid, Size, Ends);
+  splitPins(Pts, Order, Mid, End, Size, Ends);
+}
+
+// Net with the given pins in the area of N.
+static Net makeSubNet(const Net &N, const std::vector<Point> &Pts,
+                      const size_t *Idxs, size_t Num) {
+  Net Sub;
+  Sub.addCorners(N.getLBCorner(), N.getRUCorner());
+  for (size_t i = 0; i < Num; ++i)
+    Sub.addPoint(Pts[Idxs[i]]);
+  return Sub;
+}
+
+// Divide and conquer for huge nets. Pins are split into clusters of at
+// most Opts.ClusterSize pins, clusters are routed in parallel and their
+// trees are connected by the shortest edges of the spanning graph. Then
+// a subtree around each connection is rebuilt if that makes it shorter.
+static Graph<Point> partitionedSteiner(const Net &N, const SteinerOptions &Opts,
+                                       SteinerStats *Stats) {
+  std::vector<Point> Pts(N.begin(), N.end());
+  size_t PNum = Pts.size();
+  std::vector<size_t> Order(PNum);
+  std::iota(Order.begin(), Order.end(), 0);
+  std::vector<size_t> Ends;
+  splitPins(Pts, Order, 0, PNum, Opts.ClusterSize, Ends);
+  size_t CNum = Ends.size();
+  if (Stats) {
+    Stats->Pins = PNum;
+    Stats->Clusters = CNum;
+  }
+
+  // Each cluster is routed by one thread.
+  SteinerOptions LocalOpts = Opts;
+  LocalOpts.Pool = nullptr;
+  std::vector<std::vector<Point>> TreePts(CNum);
+  std::vector<std::vector<EdgeTy>> TreeEdges(CNum);
+  // Only to tell if limits of rounds were hit.
+  std::vector<SteinerStats> ClusterStats(Stats ? CNum : 0);
+  {
+    StatsTimer T(getStat(Stats, &SteinerStats::ClustersMs));
+    parallelFor(Opts.Pool, CNum, [&](size_t, size_t Begin, size_t End) {
+        for (size_t C = Begin; C < End; ++C) {
+          size_t First = C ? Ends[C - 1] : 0;
+          Graph<Point> Tree = buildTree(makeSubNet(N, Pts, &Order[First],
+                                                   Ends[C] - First),
+                                        LocalOpts,
+                                        Stats ? &ClusterStats[C] : nullptr);
+          Tree.swapVertices(TreePts[C]);
+          Tree.swapEdges(TreeEdges[C]);
+        }
+      });
+  }
+  for (const SteinerStats &CS : ClusterStats) {
+    if (CS.Stop != StopReason::Converged)
+      Stats->Stop = CS.Stop;
+  }
+
+  StatsTimer StitchTimer(getStat(Stats, &SteinerStats::StitchMs));
+  // Pins keep their indices, Steiner points of clusters follow them.
+  std::vector<EdgeTy> Edges;
+  std::vector<size_t> Cluster(PNum);
+  for (size_t C = 0; C < CNum; ++C) {
+    size_t First = C ? Ends[C - 1] : 0;
+    size_t CPins = Ends[C] - First;
+    size_t Base = Pts.size();
+    auto toGlobal = [&](size_t V) {
+      return V < CPins ? Order[First + V] : Base + V - CPins;
+    };
+    for (size_t i = First; i < Ends[C]; ++i)
+      Cluster[Order[i]] = C;
+    Pts.insert(Pts.end(), TreePts[C].begin() + CPins, TreePts[C].end());
+    Cluster.resize(Pts.size(), C);
+    for (EdgeTy E : TreeEdges[C])
+      Edges.emplace_back(toGlobal(E.From), toGlobal(E.To), E.Weight);
+    std::vector<Point>().swap(TreePts[C]);
+    std::vector<EdgeTy>().swap(TreeEdges[C]);
+  }
+
+  // MST of cluster trees together with the spanning graph of all their
+  // vertices. It mostly keeps cluster trees and connects them, but also
+  // drops their edges which are longer than connections to neighbours
+  // (the split may cut a group of pins by a cluster border).
+  std::vector<size_t> Stitches;
+  {
+    Graph<Point> Spanning(Pts.begin(), Pts.end());
+    connectSpanningGraph(Spanning);
+    std::vector<EdgeTy> All;
+    Spanning.swapEdges(All);
+    All.insert(All.end(), Edges.begin(), Edges.end());
+    std::vector<EdgeTy> Tmp;
+    sortEdgesByWeight(All, Tmp);
+    Spanning.swapEdges(All);
+    UnionFind UF;
+    getMSTEdges(Spanning, UF, Edges);
+    for (size_t i = 0, e = Edges.size(); i < e; ++i) {
+      if (Cluster[Edges[i].From] != Cluster[Edges[i].To])
+        Stitches.push_back(i);
+    }
+  }
+
+  std::vector<bool> Dead(Edges.size(), false);
+  std::vector<std::vector<size_t>> Incident(Pts.size());
+  for (size_t i = 0, e = Edges.size(); i < e; ++i) {
+    Incident[Edges[i].From].push_back(i);
+    Incident[Edges[i].To].push_back(i);
+  }
+  // Subtrees around connections are rebuilt with the cluster solver,
+  // so they are limited by the cluster size. Rebuilds stop when the
+  // deadline of the net passes, the tree is complete without them.
+  size_t WindowSize = std::max<size_t>(Opts.ClusterSize, 4);
+  std::vector<bool> InWindow(Pts.size(), false);
+  std::vector<size_t> Subtree, Window, Terminals;
+  for (size_t Stitch : Stitches) {
+    if (Opts.NetDeadline.passed()) {
+      if (Stats)
+        Stats->Stop = StopReason::TimeBudget;
+      break;
+    }
+    if (Dead[Stitch])
+      continue;
+    // Grow a subtree from the connection breadth first. Any tree
+    // connecting its pins and vertices with edges leaving it keeps
+    // the whole tree connected, so other Steiner points can move.
+    Subtree.assign(1, Stitch);
+    Window.assign({Edges[Stitch].From, Edges[Stitch].To});
+    InWindow[Window[0]] = InWindow[Window[1]] = true;
+    for (size_t Head = 0; Head < Window.size(); ++Head) {
+      for (size_t E : Incident[Window[Head]]) {
+        size_t To = Edges[E].From == Window[Head] ? Edges[E].To : Edges[E].From;
+        if (Dead[E] || InWindow[To] || Window.size() == WindowSize)
+          continue;
+        InWindow[To] = true;
+        Window.push_back(To);
+        Subtree.push_back(E);
+      }
+    }
+    Terminals.clear();
+    for (size_t V : Window) {
+      bool Boundary = V < PNum;
+      for (size_t E : Incident[V]) {
+        if (!Dead[E] && !(InWindow[Edges[E].From] && InWindow[Edges[E].To]))
+          Boundary = true;
+      }
+      if (Boundary)
+        Terminals.push_back(V);
+    }
+    for (size_t V : Window)
+      InWindow[V] = false;
+
+    Unit OldLen = 0;
+    for (size_t E : Subtree)
+      OldLen += Edges[E].Weight;
+    Graph<Point> Local = buildTree(makeSubNet(N, Pts, Terminals.data(),
+                                              Terminals.size()),
+                                   LocalOpts, nullptr);
+    if (getEdgesWeight(Local) >= OldLen)
+      continue;
+    for (size_t E : Subtree)
+      Dead[E] = true;
+    size_t TNum = Terminals.size();
+    size_t Base = Pts.size();
+    Pts.insert(Pts.end(), Local.vertices_begin() + TNum, Local.vertices_end());
+    Incident.resize(Pts.size());
+    InWindow.resize(Pts.size(), false);
+    for (EdgeTy E : Local.edges()) {
+      size_t From = E.From < TNum ? Terminals[E.From] : Base + E.From - TNum;
+      size_t To = E.To < TNum ? Terminals[E.To] : Base + E.To - TNum;
+      Incident[From].push_back(Edges.size());
+      Incident[To].push_back(Edges.size());
+      Edges.emplace_back(From, To, E.Weight);
+      Dead.push_back(false);
+    }
+    if (Stats)
+      ++Stats->BoundaryRefinements;
+  }
+
+  Graph<Point> G(Pts.begin(), Pts.end());
+  size_t Alive = 0;
+  for (size_t i = 0, e = Edges.size(); i < e; ++i) {
+    if (!Dead[i])
+      Edges[Alive++] = Edges[i];
+  }
+  Edges.resize(Alive);
+  G.swapEdges(Edges);
+
+  // Ends of replaced edges may be left with degree two or less,
+  // and removal of a leaf may leave its neighbour so.
+  SteinerScratch S;
+  S.reserve(G.vertices_size());
+  for (size_t VNum = 0; VNum != G.vertices_size();) {
+    VNum = G.vertices_size();
+    remove2DegreePoints(G, N.size(), S);
+    if (Stats)
+      Stats->RemovedPoints += VNum - G.vertices_size();
+  }
+  return G;
+}
+
+void routeNet(Net &N, const SteinerOptions &Opts, SteinerStats *Stats) {
+  if (!StatsEnabled)
+    Stats = nullptr;
+  // One deadline for all parts of the net.
+  SteinerOptions NetOpts = Opts;
+  NetOpts.NetDeadline = Deadline(Opts.TimeBudgetMs);
+  Graph<Point> G = Opts.ClusterSize && N.size() > Opts.ClusterSize ?
+    partitionedSteiner(N, NetOpts, Stats) : buildTree(N, NetOpts, Stats);
+  {
+    StatsTimer T(getStat(Stats, &SteinerStats::FillNetMs));
+    fillNet(N, G);
+  }
+  {
+    StatsTimer T(getStat(Stats, &SteinerStats::FinalizeNetMs));
+    N.finalizeNet();
+  }
+  if (Stats) {
+    Stats->SteinerPoints = G.vertices_size() - Stats->Pins;
+    Stats->Wirelength = getEdgesWeight(G);
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef STEINER_ROUTER_H_DEFINED__
+#define STEINER_ROUTER_H_DEFINED__
+
+#include "CandidateSet.h"
+#include "MST.h"
+#include "Net.h"
+#include "Parallel.h"
+#include "Stats.h"
+#include "Types.h"
+
+#include <chrono>
+#include <vector>
+
+class SteinerLUT;
+
+// Greater time budgets would overflow the clock, a year is no limit
+// in practice anyway.
+constexpr double MaxTimeBudgetMs = 365.0 * 24 * 3600 * 1000;
+
+// Time after which routing of a net stops adding points. The default
+// one never passes.
+class Deadline {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point End = Clock::time_point::max();
+
+public:
+  Deadline() = default;
+  // BudgetMs from now, zero means no limit.
+  explicit Deadline(double BudgetMs);
+
+  bool isSet() const { return End != Clock::time_point::max(); }
+  bool passed() const { return isSet() && Clock::now() >= End; }
+};
+
+struct SteinerOptions {
+  // Pool used for candidates evaluation. Null means the calling thread.
+  ThreadPool *Pool = nullptr;
+  // Add several non-interfering points per round.
+  bool Batched = false;
+  // Re-evaluate only candidates whose stale gain is on top of a heap
+  // instead of all of them each round. Ignored in batched mode. Unlike
+  // the default mode it never adds points which don't shorten the tree,
+  // as if MinGain were at least 1: zero gains are common (any point in
+  // the bounding box of an edge) and churning through them would undo
+  // the savings.
+  bool Lazy = false;
+  // Level of getCandidates pruning.
+  unsigned Pruning = 0;
+  // Nets small enough for the table are routed with it if not null.
+  const SteinerLUT *LUT = nullptr;
+  // Nets with at most this many pins get optimal trees from exactSteiner.
+  size_t ExactDegree = 0;
+  // Nets with more pins are split into clusters of at most this many
+  // pins which are routed separately and stitched together. Zero
+  // disables splitting.
+  size_t ClusterSize = 0;
+  // Limits of iteratedSteiner rounds for latency bound flows, zero means
+  // no limit. The time budget is per net, clusters of a split net share
+  // it. The tree built so far is returned when a limit is hit. The time
+  // budget is at most MaxTimeBudgetMs.
+  double TimeBudgetMs = 0;
+  size_t MaxRounds = 0;
+  // Deadline of the net being routed. routeNet sets it from TimeBudgetMs
+  // for all solvers of the net, if it isn't set iteratedSteiner starts
+  // its own.
+  Deadline NetDeadline;
+  // Points which make the tree shorter by less are not added.
+  Unit MinGain = 0;
+};
+
+// Hanan grid points which are likely to shorten the tree. Pruning 0
+// keeps all of them, 1 keeps ones inside bounding boxes of two adjacent
+// edges of MST of pins, 2 only medians of such pairs of edges.
+constexpr unsigned MaxPruning = 2;
+CandidateSet getCandidates(const Net &N, unsigned Pruning);
+
+// Iterated 1-Steiner heuristic. Returns a tree with pins as
+// first N.size() vertices followed by added Steiner points.
+// Stats are collected if not null, Stats->Stop tells if rounds
+// were stopped by a limit of Opts.
+Graph<Point> iteratedSteiner(const Net &N, CandidateSet Grid,
+                             const SteinerOptions &Opts,
+                             SteinerStats *Stats = nullptr);
+
+Unit getEdgesWeight(const Graph<Point> &G);
+
+// Add connections of the tree to the net.
+void fillNet(Net &N, const Graph<Point> &G);
+
+// Build tree for the net and put it into the net. Small nets are routed
+// exactly or with the lookup table if Opts allow it, the rest with
+// iteratedSteiner. Nets above Opts.ClusterSize are split first.
+void routeNet(Net &N, const SteinerOptions &Opts,
+              SteinerStats *Stats = nullptr);
+
+#endif
@@ -0,0 +1,72 @@
+#include "Stats.h"
+
+size_t (*getAllocationsNum)() = nullptr;
+
+void dumpJSONString(std::ostream &O, std::string_view S) {
+  O << '"';
+  for (char C : S) {
+    if (C == '"' || C == '\\')
+      O << '\\' << C;
+    else if (static_cast<unsigned char>(C) < 0x20)
+      O << "\\u00" << "0123456789abcdef"[C >> 4] << "0123456789abcdef"[C & 0xf];
+    else
+      O << C;
+  }
+  O << '"';
+}
+
+const char *getStopReasonName(StopReason R) {
+  switch (R) {
+  case StopReason::Converged:
+    return "converged";
+  case StopReason::TimeBudget:
+    return "time_budget";
+  case StopReason::MaxRounds:
+    return "max_rounds";
+  case StopReason::MinGain:
+    return "min_gain";
+  }
+  return "unknown";
+}
+
+template<typename T>
+static void dumpArray(std::ostream &O, const std::vector<T> &Arr) {
+  O << "[";
+  for (size_t i = 0, e = Arr.size(); i < e; ++i)
+    O << (i ? ", " : "") << Arr[i];
+  O << "]";
+}
+
+void SteinerStats::dumpJSONFields(std::ostream &O, const char *Indent) const {
+  O << Indent << "\"pins\": " << Pins << ", "
+    << "\"lookup_table\": " << (LookupTable ? "true" : "false") << ", "
+    << "\"exact\": " << (Exact ? "true" : "false") << ", "
+    << "\"hanan_points\": " << HananPoints << ", "
+    << "\"candidates\": " << Candidates << ",\n"
+    << Indent << "\"rounds\": " << Rounds << ", "
+    << "\"stop\": \"" << getStopReasonName(Stop) << "\",\n"
+    << Indent << "\"clusters\": " << Clusters << ", "
+    << "\"boundary_refinements\": " << BoundaryRefinements << ", "
+    << "\"clusters_ms\": " << ClustersMs << ", "
+    << "\"stitch_ms\": " << StitchMs << ",\n"
+    << Indent << "\"candidate_evaluations\": " << CandidateEvaluations << ", "
+    << "\"mst_builds\": " << MSTBuilds << ", "
+    << "\"edges_sorted\": " << EdgesSorted << ",\n"
+    << Indent << "\"removed_points\": " << RemovedPoints << ", "
+    << "\"steiner_points\": " << SteinerPoints << ", "
+    << "\"wirelength\": " << Wirelength << ",\n"
+    << Indent << "\"hanan_grid_ms\": " << HananGridMs << ", "
+    << "\"initial_mst_ms\": " << InitialMSTMs << ", "
+    << "\"rounds_ms\": " << RoundsMs << ", "
+    << "\"remove_2degree_points_ms\": " << RemovePointsMs << ",\n"
+    << Indent << "\"fill_net_ms\": " << FillNetMs << ", "
+    << "\"finalize_net_ms\": " << FinalizeNetMs << ",\n"
+    << Indent << "\"round_candidates\": ";
+  dumpArray(O, RoundCandidates);
+  O << ",\n" << Indent << "\"round_ms\": ";
+  dumpArray(O, RoundMs);
+  if (!RoundAllocations.empty()) {
+    O << ",\n" << Indent << "\"round_allocations\": ";
+    dumpArray(O, RoundAllocations);
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef STEINER_STATS_H_DEFINED__
+#define STEINER_STATS_H_DEFINED__
+
+#include "Types.h"
+
+#include <chrono>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Build with -DSTEINER_NO_STATS to compile all collection out.
+#ifdef STEINER_NO_STATS
+constexpr bool StatsEnabled = false;
+#else
+constexpr bool StatsEnabled = true;
+#endif
+
+// Why iteratedSteiner stopped adding points.
+enum class StopReason {
+  // No candidate makes the tree shorter.
+  Converged,
+  // Limits of SteinerOptions.
+  TimeBudget,
+  MaxRounds,
+  MinGain
+};
+
+const char *getStopReasonName(StopReason R);
+
+// Counters and timers of routing one net. Collected only when
+// a pointer to it is passed to the router. Times are in milliseconds.
+struct SteinerStats {
+  // Generation of candidates.
+  double HananGridMs = 0;
+  double InitialMSTMs = 0;
+  // All rounds of iteratedSteiner including addition and removal of points.
+  double RoundsMs = 0;
+  std::vector<double> RoundMs;
+  // Heap allocations made by each round, only if getAllocationsNum is set.
+  std::vector<size_t> RoundAllocations;
+  // Total time of remove2DegreePoints.
+  double RemovePointsMs = 0;
+  double FillNetMs = 0;
+  double FinalizeNetMs = 0;
+  // Routing of clusters and their stitching for split nets.
+  double ClustersMs = 0;
+  double StitchMs = 0;
+
+  size_t Pins = 0;
+  // The tree was taken from the lookup table.
+  bool LookupTable = false;
+  // The tree was built by exactSteiner.
+  bool Exact = false;
+  // Clusters the net was split into, zero if it wasn't.
+  size_t Clusters = 0;
+  // Connections of clusters replaced by shorter local trees.
+  size_t BoundaryRefinements = 0;
+  // Size of Hanan grid and the number of candidates left of it.
+  size_t HananPoints = 0;
+  size_t Candidates = 0;
+  size_t Rounds = 0;
+  StopReason Stop = StopReason::Converged;
+  std::vector<size_t> RoundCandidates;
+  // Candidates scored against the tree.
+  size_t CandidateEvaluations = 0;
+  // Full Kruskal runs.
+  size_t MSTBuilds = 0;
+  size_t EdgesSorted = 0;
+  // Steiner points removed by remove2DegreePoints.
+  size_t RemovedPoints = 0;
+  size_t SteinerPoints = 0;
+  Unit Wirelength = 0;
+
+  // Print members as JSON object fields without braces.
+  void dumpJSONFields(std::ostream &O, const char *Indent) const;
+};
+
+// Number of heap allocations made by the process so far. Set by
+// programs which count them (see Bench), null otherwise.
+extern size_t (*getAllocationsNum)();
+
+// Print S as JSON string literal.
+void dumpJSONString(std::ostream &O, std::string_view S);
+
+// Pointer to the member of stats if they are collected.
+template<typename T>
+T *getStat(SteinerStats *Stats, T SteinerStats::*Member) {
+  return StatsEnabled && Stats ? &(Stats->*Member) : nullptr;
+}
+
+// Adds time of its life to *Target. Doesn't touch the clock
+// if Target is null.
+class StatsTimer {
+  using Clock = std::chrono::steady_clock;
+  double *Target;
+  Clock::time_point Start;
+
+public:
+  explicit StatsTimer(double *Tgt): Target(StatsEnabled ? Tgt : nullptr) {
+    if (Target)
+      Start = Clock::now();
+  }
+  StatsTimer(const StatsTimer &) = delete;
+  void operator=(const StatsTimer &) = delete;
+  ~StatsTimer() {
+    if (Target)
+      *Target += std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+  }
+};
+
+#endif
@@ -1,396 +1,385 @@
-#include "MST.h"
+#include "BinaryNet.h"
+#include "ExactSteiner.h"
+#include "MappedFile.h"
+#include "LookupTable.h"
 #include "Net.h"
-#include "StlHelpers.hpp"
+#include "Parallel.h"
+#include "Router.h"
+#include "Stats.h"
 #include "Types.h"
+#include "XmlScanner.h"
+#include "XmlWriter.h"
 
 #include <algorithm>
-#include <array>
+#include <atomic>
 #include <fstream>
 #include <numeric>
-#include <regex>
+#include <memory>
 #include <string>
-#include <tuple>
-#include <utility>
 #include <vector>
 
+#include <cstdlib>
 #include <cstring>
 
-// It is actually just a product of all unique x and y coordinates.
-auto getHanansGrid(const Net &N) {
-  std::vector<Point> Grid;
-  // Collect coordinates.
-  std::vector<Unit> Xs, Ys;
-  Xs.reserve(N.size());
-  Ys.reserve(N.size());
-  for (auto Pt : N) {
-    Xs.emplace_back(Pt.x);
-    Ys.emplace_back(Pt.y);
-  }
+static bool hasSuffix(const std::string &S, const char *Suffix) {
+  size_t Len = strlen(Suffix);
+  return S.size() >= Len && S.compare(S.size() - Len, Len, Suffix) == 0;
+}
 
-  // Unique them.
-  std::sort(Xs.begin(), Xs.end());
-  std::sort(Ys.begin(), Ys.end());
-  Xs.erase(std::unique(Xs.begin(), Xs.end()), Xs.end());
-  Ys.erase(std::unique(Ys.begin(), Ys.end()), Ys.end());
+// Each <net> element of the file is a separate net. Points outside of
+// <net> elements form one more net, so files with a single net may omit
+// the element. All points are pins unless Geometry is set, in which
+// case m2_m3 vias and segments are read too and pins_m2 vias are skipped.
+std::vector<Net> buildNets(const std::string &In, bool Geometry) {
+  MappedFile File(In);
+  XmlScanner Scanner(File.begin(), File.end(), In);
+  XmlTag Tag;
+  std::vector<Net> Nets;
+  Net *Cur = nullptr;
+  bool HasGrid = false;
+  Point LB, RU;
+
+  auto startNet = [&]() {
+    Nets.emplace_back();
+    Cur = &Nets.back();
+    Cur->addCorners(LB, RU);
+  };
 
-  // Get a product.
-  Grid.reserve(Xs.size() * Ys.size());
-  for (auto X : Xs) {
-    for (auto Y : Ys) {
-      Grid.emplace_back(X, Y);
+  while (Scanner.next(Tag)) {
+    if (Tag.Name == "net") {
+      if (Tag.Closing)
+        Cur = nullptr;
+      else if (HasGrid)
+        startNet();
+      else
+        Scanner.error(Tag.Pos, "net is specified before grid");
+      continue;
+    }
+    if (Tag.Closing)
+      continue;
+    // <point x="x" y="y" ... />
+    if (Tag.Name == "point") {
+      if (!HasGrid)
+        Scanner.error(Tag.Pos, "point is specified before grid");
+      if (!Cur)
+        startNet();
+      Point P(Scanner.getUnit(Tag, "x"), Scanner.getUnit(Tag, "y"));
+      std::string_view Layer = Tag.attr("layer");
+      if (!Geometry || Layer.data() == nullptr || Layer == "pins")
+        Cur->addPoint(P);
+      else if (Layer == "m2_m3")
+        Cur->addVia(P);
+      else if (Layer != "pins_m2")
+        Scanner.error(Tag.Pos, "unknown layer of point");
+    // <segment x1="x1" y1="y1" x2="x2" y2="y2" layer="l" />
+    } else if (Tag.Name == "segment" && Geometry) {
+      if (!Cur)
+        Scanner.error(Tag.Pos, "segment is specified before points");
+      Point B(Scanner.getUnit(Tag, "x1"), Scanner.getUnit(Tag, "y1"));
+      Point E(Scanner.getUnit(Tag, "x2"), Scanner.getUnit(Tag, "y2"));
+      std::string_view Layer = Tag.attr("layer");
+      if (Layer == "m2")
+        Cur->addHorSegment(B, E);
+      else if (Layer == "m3")
+        Cur->addVertSegment(B, E);
+      else
+        Scanner.error(Tag.Pos, "unknown layer of segment");
+    // <grid min_x="x1" max_x="x2" min_y="y1" max_y="y2" />
+    } else if (Tag.Name == "grid") {
+      LB = Point(Scanner.getUnit(Tag, "min_x"), Scanner.getUnit(Tag, "min_y"));
+      RU = Point(Scanner.getUnit(Tag, "max_x"), Scanner.getUnit(Tag, "max_y"));
+      HasGrid = true;
     }
   }
 
-  // Delete duplicates of original points.
-  std::vector<Point> Pts;
-  Pts.assign(N.begin(), N.end());
-  std::sort(Pts.begin(), Pts.end());
-  auto It = std::remove_if(Grid.begin(), Grid.end(), [&](const Point P) {
-      return std::binary_search(Pts.cbegin(), Pts.cend(), P);
-    });
-  Grid.erase(It, Grid.end());
-
-  return Grid;
+  return Nets;
 }
 
-template<size_t N>
-constexpr size_t cstr_len(const char (&x)[N]) { return N - 1; }
-
-Net buildNet(const std::string &In) {
-  if (In.rfind(".xml") != In.size() - cstr_len(".xml")) {
-    report_error("File name should be <name>.xml!\n");
-  }
-
-  std::ifstream InFile(In);
-  std::string Line;
-  // <grid min_x="x1" max_x="x2" min_y="y1" max_y="y2" />
-  std::regex Grid("<[ ]*grid[^/]*/>");
-  std::regex MinX("min_x=\"([^\"]+)\"");
-  std::regex MinY("min_y=\"([^\"]+)\"");
-  std::regex MaxX("max_x=\"([^\"]+)\"");
-  std::regex MaxY("max_y=\"([^\"]+)\"");
-  // <point x="x" y="y" ... />
-  std::regex PtReg("<[ ]*point[^/]*/>");
-  std::regex PtX("x=\"([^\"]+)\"");
-  std::regex PtY("y=\"([^\"]+)\"");
-
-  std::smatch M;
-  Net N;
-  while (getline(InFile, Line)) {
-    if (std::regex_search(Line, M, PtReg)) {
-      Point P;
-      std::regex_search(Line, M, PtX);
-      P.x = std::stoi(M[1].str());
-      std::regex_search(Line, M, PtY);
-      P.y = std::stoi(M[1].str());
-      N.addPoint(P);
-    } else if (std::regex_search(Line, M, Grid)) {
-      Point LB, RU;
-      std::regex_search(Line, M, MinX);
-      LB.x = std::stoi(M[1].str());
-      std::regex_search(Line, M, MinY);
-      LB.y = std::stoi(M[1].str());
-      std::regex_search(Line, M, MaxX);
-      RU.x = std::stoi(M[1].str());
-      std::regex_search(Line, M, MaxY);
-      RU.y = std::stoi(M[1].str());
-      N.addCorners(LB, RU);
-    }
-  }
+// Read XML or binary net file depending on its extension.
+std::vector<Net> readNets(const std::string &In, bool Geometry) {
+  if (hasSuffix(In, ".xml"))
+    return buildNets(In, Geometry);
+  if (hasSuffix(In, ".snet"))
+    return readBinaryNets(In, Geometry);
+  report_error("File name should be <name>.xml or <name>.snet!\n");
+}
 
-  return N;
+struct Options {
+  std::vector<std::string> Inputs;
+  size_t Threads = 1;
+  // Print stats of stages as JSON to stdout.
+  bool Stats = false;
+  // Write output without indentation and line breaks.
+  bool Compact = false;
+  // Convert files between XML and binary formats instead of routing.
+  bool Convert = false;
+  // Lookup table for small nets, see GenLUT.
+  std::string LUTFile;
+  SteinerOptions Steiner;
+};
+
+static size_t parseUnsigned(const char *Opt, const char *Val) {
+  char *End;
+  unsigned long long Res = std::strtoull(Val, &End, 10);
+  if (*Val == '\0' || *Val == '-' || *End != '\0')
+    report_error("Invalid value for ", Opt, ": '", Val, "'.\n");
+  return Res;
 }
 
-std::string parseArgs(int argc, char **argv) {
+Options parseArgs(int argc, char **argv) {
   if (argc < 2) {
     report_error("Options should be specified. Try --help.\n");
   }
 
+  Options Opts;
   for (int i = 1; i < argc; ++i) {
     if (strcmp(argv[i], "--help") == 0) {
       std::cout <<
         "Usage: Steiner <options>.\n"
         "Allowed options:\n"
         "  --help           prints usage and exits\n"
-        "  <file>.xml       specifies input file with net configuration."
+        "  --threads <n>    route nets and evaluate candidates with n threads\n"
+        "                   (0 -- all cores)\n"
+        "  --batched        add several non-interfering points per round\n"
+        "  --lazy           re-evaluate only candidates with the best stale gain,\n"
+        "                   points which don't shorten the tree aren't added\n"
+        "                   (as if --min-gain is at least 1)\n"
+        "  --prune <n>      0 -- all Hanan grid points are candidates (default),\n"
+        "                   1 -- ones near corners of MST, 2 -- only medians\n"
+        "                   of corners\n"
+        "  --exact <n>      build optimal trees for nets with at most n pins\n"
+        "                   (n <= 16, time grows as 3^n)\n"
+        "  --cluster-size <n> split nets with more than n pins into clusters\n"
+        "                   routed separately and stitched together\n"
+        "  --time-budget <ms> stop adding points to a net after ms milliseconds\n"
+        "  --max-rounds <n> stop adding points to a net after n rounds\n"
+        "  --min-gain <n>   don't add points which shorten the tree by less\n"
+        "                   (--stats tells which nets were cut off)\n"
+        "  --stats          print counters and timings of stages as JSON\n"
+        "  --compact        write output without indentation and line breaks\n"
+        "  --convert        don't route, convert <name>.xml to <name>.snet\n"
+        "                   and <name>.snet to <name>.xml\n"
+        "  --lut <file>     route small nets with lookup table built by GenLUT\n"
+        "  <file>.xml...    specifies input files with net configurations,\n"
+        "                   each file may contain several <net> elements.\n"
+        "  <file>.snet...   the same in binary format, output is binary too."
                 << std::endl;
       exit(0);
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      if (i + 1 == argc)
+        report_error("Option --threads requires a value.\n");
+      Opts.Threads = getThreadsNum(parseUnsigned(argv[i], argv[i + 1]));
+      ++i;
+    } else if (strcmp(argv[i], "--batched") == 0) {
+      Opts.Steiner.Batched = true;
+    } else if (strcmp(argv[i], "--lazy") == 0) {
+      Opts.Steiner.Lazy = true;
+    } else if (strcmp(argv[i], "--prune") == 0) {
+      if (i + 1 == argc)
+        report_error("Option --prune requires a value.\n");
+      Opts.Steiner.Pruning = parseUnsigned(argv[i], argv[i + 1]);
+      if (Opts.Steiner.Pruning > MaxPruning)
+        report_error("Pruning level should be at most ", MaxPruning, ".\n");
+      ++i;
+    } else if (strcmp(argv[i], "--exact") == 0) {
+      if (i + 1 == argc)
+        report_error("Option --exact requires a value.\n");
+      Opts.Steiner.ExactDegree = parseUnsigned(argv[i], argv[i + 1]);
+      if (Opts.Steiner.ExactDegree > MaxExactDegree)
+        report_error("Exact solver supports at most ", MaxExactDegree,
+                     " pins.\n");
+      ++i;
+    } else if (strcmp(argv[i], "--cluster-size") == 0) {
+      if (i + 1 == argc)
+        report_error("Option --cluster-size requires a value.\n");
+      Opts.Steiner.ClusterSize = parseUnsigned(argv[i], argv[i + 1]);
+      ++i;
+    } else if (strcmp(argv[i], "--time-budget") == 0) {
+      if (i + 1 == argc)
+        report_error("Option --time-budget requires a value.\n");
+      Opts.Steiner.TimeBudgetMs =
+        std::min<double>(parseUnsigned(argv[i], argv[i + 1]), MaxTimeBudgetMs);
+      ++i;
+    } else if (strcmp(argv[i], "--max-rounds") == 0) {
+      if (i + 1 == argc)
+        report_error("Option --max-rounds requires a value.\n");
+      Opts.Steiner.MaxRounds = parseUnsigned(argv[i], argv[i + 1]);
+      ++i;
+    } else if (strcmp(argv[i], "--min-gain") == 0) {
+      if (i + 1 == argc)
+        report_error("Option --min-gain requires a value.\n");
+      Opts.Steiner.MinGain = parseUnsigned(argv[i], argv[i + 1]);
+      ++i;
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      if (!StatsEnabled)
+        report_error("Stats are disabled in this build.\n");
+      Opts.Stats = true;
+    } else if (strcmp(argv[i], "--compact") == 0) {
+      Opts.Compact = true;
+    } else if (strcmp(argv[i], "--convert") == 0) {
+      Opts.Convert = true;
+    } else if (strcmp(argv[i], "--lut") == 0) {
+      if (i + 1 == argc)
+        report_error("Option --lut requires a value.\n");
+      Opts.LUTFile = argv[++i];
     } else {
-      return {argv[i]};
+      Opts.Inputs.emplace_back(argv[i]);
     }
   }
-  __builtin_unreachable();
-}
 
-[[maybe_unused]]
-void dumpPoints(const std::vector<Point> &Pts) {
-  for (Point P : Pts) {
-    std::cout << P << std::endl;
-  }
+  if (Opts.Inputs.empty())
+    report_error("Input file should be specified. Try --help.\n");
+  return Opts;
 }
 
-using EdgeTy = typename Graph<Point>::EdgeType;
-
-// Connect new point with at most 8 others.
-// Divide all grid into octants and pick the closest
-// point in each octant.
-void connectNewPoint(std::vector<EdgeTy> &Edges, size_t PNum, const Graph<Point> &G) {
-  Point This = G.vertice(PNum);
-  std::array<size_t, 8> Selected;
-  std::array<Unit, 8> Dists;
-  Selected.fill(PNum);
-  Dists.fill(std::numeric_limits<Unit>::max());
-
-  for (size_t i = 0; i < PNum; ++i) {
-    Point To = G.vertice(i);
-    Unit XDiff = This.x - To.x;
-    Unit YDiff = This.y - To.y;
-    // Encode quadrant.
-    size_t Octant = ((static_cast<size_t>(XDiff < 0) << 1) |
-                     (static_cast<size_t>(YDiff < 0)));
-    // Based on result quadrant, select proper octant.
-    switch (Octant) {
-    case 0:
-    case 2:
-      Octant |= (static_cast<size_t>(XDiff < YDiff) << 2);
-      break;
-    case 1:
-    case 3:
-      Octant |= (static_cast<size_t>(XDiff >= YDiff) << 2);
-      break;
-    default:
-      __builtin_unreachable();
-    }
-    Unit Dist = dist(This, To);
-    if (Dist < Dists[Octant]) {
-      Selected[Octant] = i;
-      Dists[Octant] = Dist;
-    }
+// Route all nets with the pool. Nets with more pins are started first
+// so the largest ones don't end up running alone at the end. Stats[i]
+// gets stats of Nets[i] if Stats is not empty.
+void routeNets(const std::vector<Net *> &Nets,
+               const std::vector<SteinerStats *> &Stats,
+               ThreadPool *Pool, const SteinerOptions &Opts) {
+  auto getStats = [&Stats](size_t Idx) {
+    return Stats.empty() ? nullptr : Stats[Idx];
+  };
+  if (!Pool) {
+    for (size_t i = 0, e = Nets.size(); i < e; ++i)
+      routeNet(*Nets[i], Opts, getStats(i));
+    return;
   }
 
-  for (auto PtIdx : Selected) {
-    if (PtIdx != PNum)
-      Edges.emplace_back(PtIdx, PNum);
-  }
+  std::vector<size_t> Order(Nets.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  std::stable_sort(Order.begin(), Order.end(), [&Nets](size_t A, size_t B) {
+      return Nets[A]->size() > Nets[B]->size();
+    });
+  // Each thread takes the largest net not started yet, so big nets
+  // start first and their chunks don't queue up behind small nets.
+  std::atomic<size_t> Next{0};
+  auto Run = [&]() {
+    for (size_t i; (i = Next.fetch_add(1)) < Order.size();)
+      routeNet(*Nets[Order[i]], Opts, getStats(Order[i]));
+  };
+  TaskGroup Group;
+  for (size_t i = 1, e = std::min(Pool->size(), Order.size()); i < e; ++i)
+    Pool->submit(Group, [&Run]() { Run(); });
+  Run();
+  Pool->wait(Group);
 }
 
-Unit getEdgesWeight(const Graph<Point> &G) {
-  return std::accumulate(G.edges_begin(), G.edges_end(), Unit(),
-                         [&](Unit TotalLen, EdgeTy Edge) {
-                           return TotalLen + dist(G.vertice(Edge.From), G.vertice(Edge.To));
-                         });
+static void dumpXMLNets(std::ostream &O, const std::vector<Net> &Nets,
+                        bool Compact) {
+  XmlWriter W(O, Compact);
+  if (Nets.size() == 1) {
+    Nets.front().dumpXML(W);
+    return;
+  }
+  W << "<root>";
+  W.newline();
+  if (!Nets.empty())
+    Nets.front().dumpXMLGrid(W);
+  for (const auto &N : Nets)
+    N.dumpXMLNet(W);
+  W << "</root>\n";
 }
 
-// Add new point and prepare sorted edges.
-template<typename Compare>
-void prepareNewGraphEdges(Graph<Point> &G, std::vector<EdgeTy> &Edges,
-                          size_t PNum, Compare Comp) {
-  size_t CurPts = Edges.size();
-  connectNewPoint(Edges, PNum, G);
-  G.swapEdges(Edges);
-  // All old edges are already sorted so there is no need to sort all range.
-  // Just sort new edges and then merge.
-  auto B = G.edges_begin();
-  auto M = B + CurPts;
-  auto E = G.edges_end();
-  std::sort(M, E, Comp);
-  std::inplace_merge(B, M, E, Comp);
+// Write nets to FName in the format given by its extension.
+void dumpNets(const std::vector<Net> &Nets, const std::string &FName,
+              bool Compact) {
+  std::ofstream OutFile(FName, std::ios::binary);
+  if (!OutFile)
+    report_error("Can't open file '", FName, "'.\n");
+  if (hasSuffix(FName, ".snet"))
+    writeBinaryNets(OutFile, Nets);
+  else
+    dumpXMLNets(OutFile, Nets, Compact);
 }
 
-using VertEdges = std::pair<EdgeTy *, EdgeTy *>;
-
-static void
-rememberEdge(EdgeTy *Edge, std::vector<VertEdges> &EdgesToConnect,
-             int Degree, size_t VertIdx) {
-  if (Degree == 1)
-    EdgesToConnect[VertIdx].first = Edge;
-  else if (Degree == 2)
-    EdgesToConnect[VertIdx].second = Edge;
-  else {
-    EdgesToConnect[VertIdx].first = nullptr;
-    EdgesToConnect[VertIdx].second = nullptr;
-  }
+// <name>_out.<ext> for routed nets or <name>.<other ext> for conversion.
+std::string getOutputName(const std::string &In, bool Convert) {
+  size_t Dot = In.rfind('.');
+  std::string Name = In.substr(0, Dot);
+  bool Binary = hasSuffix(In, ".snet");
+  if (Convert)
+    return Name + (Binary ? ".xml" : ".snet");
+  return Name + (Binary ? "_out.snet" : "_out.xml");
 }
 
-void remove2DegreePoints(Graph<Point> &G, size_t NetPts) {
-  std::vector<int> Degrees(G.vertices_size() - NetPts);
-  std::vector<VertEdges> EdgesToConnect(Degrees.size());
-
-  // Find all added vertices with degree <= 2.
-  for (auto &Edge : G.edges()) {
-    if (Edge.From >= NetPts) {
-      int DFrom = ++Degrees[Edge.From - NetPts];
-      rememberEdge(&Edge, EdgesToConnect, DFrom, Edge.From - NetPts);
-    }
-    if (Edge.To >= NetPts) {
-      int DTo = ++Degrees[Edge.To - NetPts];
-      rememberEdge(&Edge, EdgesToConnect, DTo, Edge.To - NetPts);
+// Stats of one input file.
+struct FileStats {
+  double ParseMs = 0;
+  double DumpMs = 0;
+  std::vector<SteinerStats> Nets;
+};
+
+void dumpStats(std::ostream &O, const Options &Opts,
+               const std::vector<FileStats> &Stats, double RouteMs) {
+  O << "{\n  \"threads\": " << Opts.Threads << ", "
+    << "\"batched\": " << (Opts.Steiner.Batched ? "true" : "false") << ", "
+    << "\"route_ms\": " << RouteMs << ",\n"
+    << "  \"files\": [";
+  for (size_t i = 0, e = Stats.size(); i < e; ++i) {
+    const FileStats &F = Stats[i];
+    O << (i ? ",\n" : "\n") << "    {\"file\": ";
+    dumpJSONString(O, Opts.Inputs[i]);
+    O << ", \"parse_ms\": " << F.ParseMs << ", "
+      << "\"dump_ms\": " << F.DumpMs << ",\n"
+      << "     \"nets\": [";
+    for (size_t j = 0, je = F.Nets.size(); j < je; ++j) {
+      O << (j ? ",\n" : "\n") << "      {\n";
+      F.Nets[j].dumpJSONFields(O, "       ");
+      O << "}";
     }
+    O << "]}";
   }
+  O << "]\n}" << std::endl;
+}
 
-  // Connect edges or remove them.
-  for (size_t VertIdx = 0, VE = Degrees.size(); VertIdx < VE; ++VertIdx) {
-    int D = Degrees[VertIdx];
-    // Degree == one -- remove. Mark edge for later removal.
-    if (D == 1) {
-      auto &Edge = *EdgesToConnect[VertIdx].first;
-      Edge.From = 0;
-      Edge.To = 0;
-    }
-    // Degree == two -- connect.
-    if (D == 2) {
-      auto &Edge1 = *EdgesToConnect[VertIdx].first;
-      auto &Edge2 = *EdgesToConnect[VertIdx].second;
-      size_t Vert = VertIdx + NetPts;
-      // x -> a
-      if (Edge1.From == Vert) {
-        // x -> b
-        if (Edge2.From == Vert)
-          // b -> a
-          Edge1.From = Edge2.To;
-        // b -> x
-        else
-          // b -> a
-          Edge1.From = Edge2.From;
-      // a -> x
-      } else {
-        // x -> b
-        if (Edge2.From == Vert)
-          // a -> b
-          Edge1.To = Edge2.To;
-        // b -> x
-        else
-          // a -> b
-          Edge1.To = Edge2.From;
-      }
-      // Save all info since next iterations could use this info.
-      Edge2 = Edge1;
-    }
+int main(int argc, char **argv) {
+  Options Opts = parseArgs(argc, argv);
+  std::unique_ptr<ThreadPool> Pool;
+  if (Opts.Threads > 1) {
+    Pool = std::make_unique<ThreadPool>(Opts.Threads);
+    Opts.Steiner.Pool = Pool.get();
   }
-
-  // Remove all deleted edges.
-  G.edges_erase(std::remove_if(G.edges_begin(), G.edges_end(),
-                               [](EdgeTy E) {
-        return E.From == 0 && E.To == 0;
-      }), G.edges_end());
-
-  // Remove joined edges.
-  std::sort(G.edges_begin(), G.edges_end());
-  G.edges_erase(std::unique(G.edges_begin(), G.edges_end()), G.edges_end());
-
-  auto Res = remove_if_with_index(G.vertices_begin() + NetPts,
-                                  G.vertices_end(),
-                                  [&](Point Pt, size_t Idx) {
-                                    return Degrees[Idx] <= 2;
-                                  });
-  G.vertices_erase(Res, G.vertices_end());
-
-  // Shift points. Removed point can be in the middle
-  // so we need to adjust all edges that contain points
-  // after removed ones.
-  for (int i = Degrees.size() - 1, e = 0; i >= e; --i) {
-    if (Degrees[i] <= 2) {
-      size_t VIdx = i + NetPts;
-      for (auto &Edge : G.edges()) {
-        if (Edge.From > VIdx)
-          --Edge.From;
-        if (Edge.To > VIdx)
-          --Edge.To;
-      }
-    }
+  std::unique_ptr<SteinerLUT> LUT;
+  if (!Opts.LUTFile.empty()) {
+    LUT = std::make_unique<SteinerLUT>(Opts.LUTFile);
+    Opts.Steiner.LUT = LUT.get();
   }
-}
-
-auto iteratedSteiner(const Net &N, std::vector<Point> Grid) {
-
-  bool Changed = true;
-  Graph<Point> G(N.begin(), N.end());
-  G.connectAllToAll();
-
-  std::vector<EdgeTy> TmpEdges;
-  TmpEdges.reserve(G.edges_size());
-
-  auto EdgeSort = [&](const EdgeTy &A, const EdgeTy &B) {
-    auto ADist = dist(G.vertice(A.From), G.vertice(A.To));
-    auto BDist = dist(G.vertice(B.From), G.vertice(B.To));
-    return ADist < BDist;
-  };
-
-  // Initial length.
-  // TODO: remove this after special graph methods will be added.
-  std::sort(G.edges_begin(), G.edges_end(), EdgeSort);
-  G.swapEdges(getMSTEdges(G));
-  Unit MinLen = getEdgesWeight(G);
+  bool CollectStats = StatsEnabled && Opts.Stats;
+  std::vector<FileStats> Stats(CollectStats ? Opts.Inputs.size() : 0);
 
-  while (Changed && !Grid.empty()) {
-    Changed = false;
-    size_t GridSize = Grid.size();
-    size_t BestCandidateIdx;
-    size_t OldPNum = G.vertices_size();
-
-    for (size_t i = 0; i < GridSize; ++i) {
-      Point Pt = Grid[i];
-
-      // Create new state with added point and add it to graph.
-      G.push_vertice(Pt);
-      TmpEdges.assign(G.edges_begin(), G.edges_end());
-      prepareNewGraphEdges(G, TmpEdges, OldPNum, EdgeSort);
-      Unit NewLen = getMSTLen(G);
-
-      // Save point if it is the best solution.
-      if (NewLen <= MinLen) {
-        Changed = true;
-        BestCandidateIdx = i;
-        MinLen = NewLen;
-      }
-
-      // Restore initial state.
-      G.pop_vertice();
-      G.swapEdges(TmpEdges);
-    }
-
-    // Add new point.
-    if (Changed) {
-      G.push_vertice(Grid[BestCandidateIdx]);
-      TmpEdges.assign(G.edges_begin(), G.edges_end());
-      prepareNewGraphEdges(G, TmpEdges, OldPNum, EdgeSort);
-      G.swapEdges(getMSTEdges(G));
-
-      remove2DegreePoints(G, N.size());
-      std::sort(G.edges_begin(), G.edges_end(), EdgeSort);
+  std::vector<std::vector<Net>> Files;
+  for (size_t i = 0, e = Opts.Inputs.size(); i < e; ++i) {
+    StatsTimer T(CollectStats ? &Stats[i].ParseMs : nullptr);
+    Files.emplace_back(readNets(Opts.Inputs[i], Opts.Convert));
+  }
 
-      // Remove selected point from list of candidates.
-      std::swap(Grid[BestCandidateIdx], Grid.back());
-      Grid.pop_back();
+  std::vector<Net *> Nets;
+  std::vector<SteinerStats *> NetStats;
+  for (size_t i = 0, e = Files.size(); i < e; ++i) {
+    if (CollectStats)
+      Stats[i].Nets.resize(Files[i].size());
+    for (size_t j = 0, je = Files[i].size(); j < je; ++j) {
+      Nets.push_back(&Files[i][j]);
+      if (CollectStats)
+        NetStats.push_back(&Stats[i].Nets[j]);
     }
   }
 
-  return G;
-}
-
-void fillNet(Net &N, const Graph<Point> &G) {
-  for (auto Edge : G.edges()) {
-    N.addConnection(G.vertice(Edge.From), G.vertice(Edge.To));
+  double RouteMs = 0;
+  if (!Opts.Convert) {
+    StatsTimer T(CollectStats ? &RouteMs : nullptr);
+    routeNets(Nets, NetStats, Pool.get(), Opts.Steiner);
   }
-}
 
-void dumpNet(const Net &N, std::string FName) {
-  FName.insert(FName.size() - cstr_len(".xml"), "_out", cstr_len("_out"));
-  std::ofstream OutFile(FName);
-  N.dumpXML(OutFile);
-}
+  for (size_t i = 0, e = Files.size(); i < e; ++i) {
+    StatsTimer T(CollectStats ? &Stats[i].DumpMs : nullptr);
+    dumpNets(Files[i], getOutputName(Opts.Inputs[i], Opts.Convert),
+             Opts.Compact);
+  }
 
-int main(int argc, char **argv) {
-  std::string In = parseArgs(argc, argv);
-  Net N = buildNet(In);
-  std::vector<Point> C = getHanansGrid(N);
-  Graph<Point> G = iteratedSteiner(N, std::move(C));
-  fillNet(N, G);
-  N.finalizeNet();
-  dumpNet(N, std::move(In));
-#ifdef DEBUG_DUMP
-  G.dump();
-  std::cerr << getEdgesWeight(G) << "\n";
-#endif
+  if (CollectStats)
+    dumpStats(std::cout, Opts, Stats, RouteMs);
   return 0;
 }
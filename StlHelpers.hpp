@@ -1,7 +1,9 @@
 #ifndef STEINER_STL_HELPERS_H_DEFINED__
 #define STEINER_STL_HELPERS_H_DEFINED__
 
+#include <algorithm>
 #include <utility>
+#include <vector>
 
 // Special remove if.
 template<typename It, typename Predicate>
@@ -26,4 +28,19 @@ It remove_if_with_index(It first, It last, Predicate Pred) {
   return result;
 }
 
+// Reserve space for at least N elements growing capacity geometrically,
+// so buffers reused for slowly growing sizes don't reallocate each time.
+template<typename T>
+void reserve_geometric(std::vector<T> &V, size_t N) {
+  if (N > V.capacity())
+    V.reserve(std::max(N, 2 * V.capacity()));
+}
+
+// V.assign(N, Val) with reserve_geometric.
+template<typename T>
+void assign_geometric(std::vector<T> &V, size_t N, const T &Val) {
+  reserve_geometric(V, N);
+  V.assign(N, Val);
+}
+
 #endif
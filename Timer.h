@@ -0,0 +1,21 @@
+#ifndef STEINER_TIMER_H_DEFINED__
+#define STEINER_TIMER_H_DEFINED__
+
+#include <chrono>
+
+// Wall clock stopwatch.
+class Timer {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point Start;
+
+public:
+  Timer(): Start(Clock::now()) {}
+
+  void reset() { Start = Clock::now(); }
+
+  double elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+  }
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "XmlScanner.h"
+
+#include <charconv>
+#include <cstring>
+
+bool XmlScanner::isNameChar(char C) {
+  return (C >= 'a' && C <= 'z') || (C >= 'A' && C <= 'Z') ||
+    (C >= '0' && C <= '9') || C == '_' || C == '-' || C == ':' || C == '.';
+}
+
+void XmlScanner::skipPast(std::string_view Terminator, const char *Start) {
+  for (; Cur + Terminator.size() <= End; ++Cur) {
+    if (std::memcmp(Cur, Terminator.data(), Terminator.size()) == 0) {
+      Cur += Terminator.size();
+      return;
+    }
+  }
+  error(Start, "unterminated construct, expected '", Terminator, "'");
+}
+
+std::string_view XmlScanner::readName() {
+  const char *Start = Cur;
+  while (Cur != End && isNameChar(*Cur))
+    ++Cur;
+  return {Start, static_cast<size_t>(Cur - Start)};
+}
+
+bool XmlScanner::next(XmlTag &Tag) {
+  for (;;) {
+    // Skip text.
+    Cur = static_cast<const char *>(std::memchr(Cur, '<', End - Cur));
+    if (!Cur) {
+      Cur = End;
+      return false;
+    }
+
+    const char *Start = Cur;
+    ++Cur;
+    if (Cur == End)
+      error(Start, "unexpected end of file");
+
+    if (*Cur == '!') {
+      if (End - Cur >= 3 && Cur[1] == '-' && Cur[2] == '-')
+        skipPast("-->", Start);
+      else
+        skipPast(">", Start);
+      continue;
+    }
+    if (*Cur == '?') {
+      skipPast("?>", Start);
+      continue;
+    }
+
+    Tag.Pos = Start;
+    Tag.Closing = false;
+    Tag.SelfClosing = false;
+    Tag.NumAttrs = 0;
+    if (*Cur == '/') {
+      Tag.Closing = true;
+      ++Cur;
+    }
+    skipSpaces();
+    Tag.Name = readName();
+    if (Tag.Name.empty())
+      error(Cur, "expected tag name");
+
+    for (;;) {
+      skipSpaces();
+      if (Cur == End)
+        error(Start, "unterminated tag '", Tag.Name, "'");
+      if (*Cur == '>') {
+        ++Cur;
+        return true;
+      }
+      if (*Cur == '/') {
+        if (Cur + 1 == End || Cur[1] != '>')
+          error(Cur, "expected '/>'");
+        if (Tag.Closing)
+          error(Cur, "closing tag '", Tag.Name, "' can't be self-closing");
+        Tag.SelfClosing = true;
+        Cur += 2;
+        return true;
+      }
+      if (Tag.Closing)
+        error(Cur, "unexpected character in closing tag '", Tag.Name, "'");
+
+      // Attribute: name = "value" or name = 'value'.
+      const char *AttrPos = Cur;
+      std::string_view AttrName = readName();
+      if (AttrName.empty())
+        error(Cur, "unexpected character '", *Cur, "' in tag '", Tag.Name, "'");
+      skipSpaces();
+      if (Cur == End || *Cur != '=')
+        error(Cur, "expected '=' after attribute '", AttrName, "'");
+      ++Cur;
+      skipSpaces();
+      if (Cur == End || (*Cur != '"' && *Cur != '\''))
+        error(Cur, "expected quoted value of attribute '", AttrName, "'");
+      char Quote = *Cur++;
+      const char *ValBegin = Cur;
+      const char *ValEnd = static_cast<const char *>(std::memchr(Cur, Quote, End - Cur));
+      if (!ValEnd)
+        error(ValBegin - 1, "unterminated value of attribute '", AttrName, "'");
+      Cur = ValEnd + 1;
+
+      if (Tag.NumAttrs == XmlTag::MaxAttrs)
+        error(AttrPos, "too many attributes in tag '", Tag.Name, "'");
+      Tag.Attrs[Tag.NumAttrs++] = {
+        AttrName, {ValBegin, static_cast<size_t>(ValEnd - ValBegin)}};
+    }
+  }
+}
+
+Unit XmlScanner::getUnit(const XmlTag &Tag, std::string_view AttrName) const {
+  std::string_view Val = Tag.attr(AttrName);
+  if (!Val.data())
+    error(Tag.Pos, "missing attribute '", AttrName, "' in tag '", Tag.Name, "'");
+
+  Unit Res;
+  const char *B = Val.data();
+  const char *E = B + Val.size();
+  // from_chars doesn't accept explicit plus sign.
+  if (B != E && *B == '+')
+    ++B;
+  auto [Ptr, Err] = std::from_chars(B, E, Res);
+  if (Err == std::errc::result_out_of_range)
+    error(Val.data(), "value of attribute '", AttrName, "' is out of range");
+  if (Err != std::errc() || Ptr != E || B == E)
+    error(Val.data(), "expected integer value of attribute '", AttrName,
+          "', got '", Val, "'");
+  return Res;
+}
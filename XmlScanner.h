@@ -0,0 +1,82 @@
+#ifndef STEINER_XML_SCANNER_H_DEFINED__
+#define STEINER_XML_SCANNER_H_DEFINED__
+
+#include "Support.h"
+#include "Types.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Start or end tag. All views point into the scanned buffer.
+struct XmlTag {
+  static constexpr size_t MaxAttrs = 16;
+
+  std::string_view Name;
+  // </name>
+  bool Closing = false;
+  // <name ... />
+  bool SelfClosing = false;
+  // Position of '<'.
+  const char *Pos = nullptr;
+  size_t NumAttrs = 0;
+  std::array<std::pair<std::string_view, std::string_view>, MaxAttrs> Attrs;
+
+  // Value of attribute. View with null data() if there is no such attribute.
+  std::string_view attr(std::string_view AttrName) const {
+    for (size_t i = 0; i < NumAttrs; ++i) {
+      if (Attrs[i].first == AttrName)
+        return Attrs[i].second;
+    }
+    return {};
+  }
+};
+
+// Minimal non-validating XML scanner over a memory buffer. It reports
+// tags with attributes and skips text, comments, processing
+// instructions and declarations. Doesn't allocate memory.
+class XmlScanner {
+  const char *Begin, *Cur, *End;
+  std::string FName;
+
+  void skipSpaces() {
+    while (Cur != End && isSpace(*Cur))
+      ++Cur;
+  }
+  static bool isSpace(char C) {
+    return C == ' ' || C == '\t' || C == '\n' || C == '\r';
+  }
+  static bool isNameChar(char C);
+
+  void skipPast(std::string_view Terminator, const char *Start);
+  std::string_view readName();
+
+public:
+  XmlScanner(const char *B, const char *E, std::string FileName):
+    Begin(B), Cur(B), End(E), FName(std::move(FileName)) {}
+
+  // Read next tag. Returns false at the end of buffer.
+  bool next(XmlTag &Tag);
+
+  // Report error at Pos as <file>:<line>:<column> and exit.
+  template<typename... Args>
+  [[noreturn]] void error(const char *Pos, Args&&... args) const {
+    size_t Line = 1, Col = 1;
+    for (const char *P = Begin; P != Pos; ++P) {
+      if (*P == '\n') {
+        ++Line;
+        Col = 1;
+      } else {
+        ++Col;
+      }
+    }
+    report_error(FName, ":", Line, ":", Col, ": error: ",
+                 std::forward<Args>(args)..., "\n");
+  }
+
+  // Get required integer attribute of Tag.
+  Unit getUnit(const XmlTag &Tag, std::string_view AttrName) const;
+};
+
+#endif
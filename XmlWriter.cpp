@@ -0,0 +1,59 @@
+#include "XmlWriter.h"
+
+#include <charconv>
+#include <limits>
+
+#include <cstring>
+
+XmlWriter::XmlWriter(std::ostream &Out, bool IsCompact, size_t BufSize):
+  O(Out), Buf(new char[BufSize]), Capacity(BufSize), Compact(IsCompact) {}
+
+XmlWriter &XmlWriter::operator<<(std::string_view S) {
+  if (Capacity - Size < S.size()) {
+    flush();
+    // Too long to be buffered at all.
+    if (S.size() >= Capacity) {
+      O.write(S.data(), S.size());
+      return *this;
+    }
+  }
+  std::memcpy(Buf.get() + Size, S.data(), S.size());
+  Size += S.size();
+  return *this;
+}
+
+XmlWriter &XmlWriter::operator<<(char C) {
+  if (Size == Capacity)
+    flush();
+  Buf[Size++] = C;
+  return *this;
+}
+
+XmlWriter &XmlWriter::operator<<(Unit V) {
+  // Sign and all digits.
+  constexpr size_t MaxLen = std::numeric_limits<Unit>::digits10 + 2;
+  if (Capacity - Size < MaxLen)
+    flush();
+  char *End = std::to_chars(Buf.get() + Size, Buf.get() + Capacity, V).ptr;
+  Size = End - Buf.get();
+  return *this;
+}
+
+void XmlWriter::indent(unsigned Depth) {
+  if (Compact)
+    return;
+  for (unsigned i = 0; i < Depth; ++i)
+    *this << "  ";
+}
+
+void XmlWriter::newline() {
+  if (!Compact)
+    *this << '\n';
+}
+
+void XmlWriter::flush() {
+  if (Size == 0)
+    return;
+  O.write(Buf.get(), Size);
+  Size = 0;
+}
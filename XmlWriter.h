@@ -0,0 +1,42 @@
+#ifndef STEINER_XML_WRITER_H_DEFINED__
+#define STEINER_XML_WRITER_H_DEFINED__
+
+#include "Types.h"
+
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+// Formats XML into a large buffer and passes it to the stream in big
+// chunks, so the stream is neither flushed nor called per element.
+// Numbers are printed with std::to_chars. In compact mode indentation
+// and line breaks are omitted.
+class XmlWriter {
+  std::ostream &O;
+  std::unique_ptr<char[]> Buf;
+  size_t Capacity;
+  size_t Size = 0;
+  bool Compact;
+
+public:
+  explicit XmlWriter(std::ostream &Out, bool IsCompact = false,
+                     size_t BufSize = 1 << 20);
+
+  XmlWriter(const XmlWriter &) = delete;
+  void operator=(const XmlWriter &) = delete;
+  ~XmlWriter() { flush(); }
+
+  XmlWriter &operator<<(std::string_view S);
+  XmlWriter &operator<<(char C);
+  XmlWriter &operator<<(Unit V);
+
+  // Start a line nested Depth levels deep.
+  void indent(unsigned Depth);
+  // End the current line.
+  void newline();
+
+  // Pass everything buffered to the stream. Doesn't flush the stream.
+  void flush();
+};
+
+#endif